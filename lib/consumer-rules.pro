@@ -1,3 +1,7 @@
 -keepclasseswithmembernames class dev.rushii.libunbound.LibUnbound {
     native <methods>;
 }
+
+-keep class dev.rushii.libunbound.HermesBundleInfo {
+    <init>(...);
+}
@@ -0,0 +1,93 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "../proc_maps.hpp"
+
+/*
+ * Times proc_map_query() (PROCMAP_QUERY ioctl when supported) against proc_map_query_text()
+ * and checks that both return the same mapping for a set of addresses.
+ * Exits with a non-zero status if any result differs.
+ */
+
+static constexpr int ITERATIONS = 1000;
+
+struct query_case_t {
+    const char *name;
+    const void *address;
+    proc_map_flags_t required_flags;
+    uint8_t query_flags;
+};
+
+static bool same_map(const proc_map_t &a, const proc_map_t &b) {
+    return a.address_start == b.address_start
+           && a.address_end == b.address_end
+           && a.flags == b.flags
+           && a.offset == b.offset
+           && a.dev_major == b.dev_major
+           && a.dev_minor == b.dev_minor
+           && a.inode == b.inode
+           && a.file_name == b.file_name;
+}
+
+template<typename F>
+static double time_query(F &&query) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; i++) query();
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / ITERATIONS;
+}
+
+int main() {
+    int stack_value = 0;
+    void *heap = malloc(64);
+    long page_size = sysconf(_SC_PAGESIZE);
+    void *anon = mmap(nullptr, page_size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    const query_case_t cases[] = {
+            {"code", reinterpret_cast<const void *>(&main), 0, 0},
+            {"code (r-x)", reinterpret_cast<const void *>(&main), PROC_MAP_READ | PROC_MAP_EXEC, 0},
+            {"libc", reinterpret_cast<const void *>(&malloc), 0, 0},
+            {"stack", &stack_value, 0, 0},
+            {"heap", heap, PROC_MAP_READ | PROC_MAP_WRITE, 0},
+            {"anonymous", anon, 0, 0},
+            {"anonymous (file-backed)", anon, 0, PROC_MAP_QUERY_FILE_BACKED},
+            {"null", nullptr, 0, 0},
+            {"null (next)", nullptr, 0, PROC_MAP_QUERY_COVERING_OR_NEXT},
+            {"null (next file-backed)", nullptr, 0, PROC_MAP_QUERY_COVERING_OR_NEXT | PROC_MAP_QUERY_FILE_BACKED},
+    };
+
+    printf("PROCMAP_QUERY supported: %s\n", proc_map_query_supported() ? "yes" : "no");
+
+    int mismatches = 0;
+    for (const auto &c: cases) {
+        proc_map_t fast{}, text{};
+        bool fast_found = proc_map_query(c.address, fast, c.required_flags, c.query_flags);
+        bool text_found = proc_map_query_text(c.address, text, c.required_flags, c.query_flags);
+
+        bool match = fast_found == text_found && (!fast_found || same_map(fast, text));
+        if (!match) mismatches++;
+
+        double fast_us = time_query([&] {
+            proc_map_t map;
+            proc_map_query(c.address, map, c.required_flags, c.query_flags);
+        });
+        double text_us = time_query([&] {
+            proc_map_t map;
+            proc_map_query_text(c.address, map, c.required_flags, c.query_flags);
+        });
+
+        printf("%-26s %-8s query %8.2fus  text %8.2fus  %s\n",
+               c.name, fast_found ? "found" : "missing", fast_us, text_us, match ? "ok" : "MISMATCH");
+        if (!match && fast_found && text_found) {
+            printf("    query: %p-%p %s\n    text:  %p-%p %s\n",
+                   fast.address_start, fast.address_end, fast.file_name.c_str(),
+                   text.address_start, text.address_end, text.file_name.c_str());
+        }
+    }
+
+    munmap(anon, page_size);
+    free(heap);
+    return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -17,8 +17,11 @@
  * Copyright (C) 2019 Swift Gan
  * Copyright (C) 2021 LSPosed Contributors
  */
+#include <algorithm>
 #include <malloc.h>
 #include <cstring>
+#include <format>
+#include <iterator>
 #include <sys/mman.h>
 #include <fcntl.h>
 #include <unistd.h>
@@ -28,6 +31,7 @@
 #include "logging.hpp"
 #include "proc_maps.hpp"
 #include "elf_util.hpp"
+#include "minidebuginfo.hpp"
 #include "zip_util.hpp"
 
 using namespace SandHook;
@@ -38,6 +42,53 @@ inline constexpr auto offsetOf(ElfW(Ehdr) *head, ElfW(Off) off) {
             reinterpret_cast<uintptr_t>(head) + off);
 }
 
+/**
+ * Finds a section of a mapped ELF file by its type and name.
+ */
+static const ElfW(Shdr) *findSection(ElfW(Ehdr) *header, ElfW(Word) type, const char *name) {
+    auto *section_h = offsetOf<ElfW(Shdr) *>(header, header->e_shoff);
+    char *section_str = offsetOf<char *>(header, section_h[header->e_shstrndx].sh_offset);
+
+    for (int i = 0; i < header->e_shnum; i++) {
+        if (section_h[i].sh_type == type && strcmp(section_str + section_h[i].sh_name, name) == 0)
+            return &section_h[i];
+    }
+    return nullptr;
+}
+
+/**
+ * Reads the hex encoded GNU build ID of a mapped ELF file, or an empty string if it has none.
+ */
+static std::string readBuildId(ElfW(Ehdr) *header) {
+    auto *section_h = findSection(header, SHT_NOTE, ".note.gnu.build-id");
+    if (!section_h) return {};
+
+    auto *note = offsetOf<ElfW(Nhdr) *>(header, section_h->sh_offset);
+    if (note->n_type != NT_GNU_BUILD_ID || note->n_namesz != 4) return {};
+
+    // The descriptor follows the 4-byte aligned "GNU\0" name
+    std::string build_id;
+    auto *desc = reinterpret_cast<const uint8_t *>(note + 1) + 4;
+    for (ElfW(Word) j = 0; j < note->n_descsz; j++) {
+        std::format_to(std::back_inserter(build_id), "{:02x}", desc[j]);
+    }
+    return build_id;
+}
+
+/**
+ * Identifies a mapped ELF file by its build ID, falling back to the attributes of the file backing it.
+ */
+static SymbolIndex::Identity readIdentity(ElfW(Ehdr) *header, const struct stat &st, size_t fileOffset) {
+    SymbolIndex::Identity identity{.build_id = readBuildId(header)};
+    if (identity.build_id.empty()) {
+        identity.file_size = static_cast<uint64_t>(st.st_size);
+        identity.inode = static_cast<uint64_t>(st.st_ino);
+        identity.mtime = static_cast<int64_t>(st.st_mtime);
+        identity.file_offset = static_cast<uint64_t>(fileOffset);
+    }
+    return identity;
+}
+
 ElfImg::ElfImg(std::string_view base_name) : elfPath(base_name) {
     if (!findModuleBase()) {
         base = nullptr;
@@ -59,6 +110,9 @@ ElfImg::ElfImg(std::string_view base_name) : elfPath(base_name) {
         }
     }
 
+    struct stat st{};
+    fstat(fd, &st);
+
     header = reinterpret_cast<decltype(header)>(mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, elfFileOffset));
 
     close(fd);
@@ -103,6 +157,9 @@ ElfImg::ElfImg(std::string_view base_name) : elfPath(base_name) {
                 break;
             }
             case SHT_PROGBITS: {
+                if (strcmp(sname, ".gnu_debugdata") == 0) {
+                    debugdata_ = {offsetOf<const uint8_t *>(header, section_h->sh_offset), section_h->sh_size};
+                }
                 if (strtab == nullptr || dynsym == nullptr) break;
                 if (bias == -4396) {
                     bias = (off_t) section_h->sh_addr - (off_t) section_h->sh_offset;
@@ -131,6 +188,121 @@ ElfImg::ElfImg(std::string_view base_name) : elfPath(base_name) {
             }
         }
     }
+
+    identity_ = readIdentity(header, st, elfFileOffset);
+    setDebugDataKey();
+}
+
+void ElfImg::setDebugDataKey() {
+    // Without a build ID, only images of the same file can share the decoded MiniDebugInfo
+    if (!debugdata_.empty()) {
+        debugdata_key_ = !identity_.build_id.empty()
+                         ? identity_.build_id
+                         : std::format("{}@{:#x}", elfPath, elfFileOffset);
+    }
+}
+
+ElfImg::ElfImg(std::string_view base_name, SymbolIndex index) : elfPath(base_name) {
+    if (!findModuleBase()) {
+        base = nullptr;
+        return;
+    }
+
+    // Map the file only long enough to check that the index belongs to this build of the module
+    int fd = open(elfPath.data(), O_RDONLY | O_CLOEXEC);
+    struct stat st{};
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        LOGE("failed to open {}", elfPath);
+        if (fd >= 0) close(fd);
+        base = nullptr;
+        return;
+    }
+
+    auto mapSize = size ? static_cast<size_t>(size) : static_cast<size_t>(st.st_size);
+    auto *mapped = mmap(nullptr, mapSize, PROT_READ, MAP_SHARED, fd, elfFileOffset);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        LOGE("failed to map {}", elfPath);
+        base = nullptr;
+        return;
+    }
+
+    auto *mappedHeader = reinterpret_cast<ElfW(Ehdr) *>(mapped);
+    auto identity = readIdentity(mappedHeader, st, elfFileOffset);
+
+    if (identity != index.identity()) {
+        LOGE("symbol index does not match the loaded {}", elfPath);
+        munmap(mapped, mapSize);
+        base = nullptr;
+        return;
+    }
+
+    // The index doesn't include MiniDebugInfo, so keep it around for lookups just like freeze() does
+    if (auto *section_h = findSection(mappedHeader, SHT_PROGBITS, ".gnu_debugdata")) {
+        auto *data = offsetOf<const uint8_t *>(mappedHeader, section_h->sh_offset);
+        debugdata_owned_.assign(data, data + section_h->sh_size);
+        debugdata_ = debugdata_owned_;
+    }
+    munmap(mapped, mapSize);
+
+    bias = index.bias();
+    identity_ = std::move(identity);
+    index_ = std::move(index);
+    setDebugDataKey();
+}
+
+bool ElfImg::freeze() {
+    if (index_) return true;
+    if (!header) return false;
+
+    SymbolIndex index;
+    index.setBias(bias);
+    index.setIdentity(identity_);
+
+    if (dynsym_start != nullptr && strtab_start != nullptr && dynsym->sh_entsize) {
+        auto *strings = reinterpret_cast<const char *>(strtab_start);
+        auto count = dynsym->sh_size / dynsym->sh_entsize;
+        for (ElfW(Off) i = 0; i < count; i++) {
+            auto &sym = dynsym_start[i];
+            if (sym.st_shndx == SHN_UNDEF || !sym.st_value) continue;
+            index.add(strings + sym.st_name, sym.st_value, sym.st_size, ELF_ST_TYPE(sym.st_info), SymbolIndex::SOURCE_DYNSYM);
+        }
+    }
+
+    if (symtab_start != nullptr && symstr_offset_for_symtab != 0) {
+        for (ElfW(Off) i = 0; i < symtab_count; i++) {
+            auto &sym = symtab_start[i];
+            unsigned int st_type = ELF_ST_TYPE(sym.st_info);
+            if ((st_type == STT_FUNC || st_type == STT_OBJECT) && sym.st_size) {
+                auto *st_name = offsetOf<const char *>(header, symstr_offset_for_symtab + sym.st_name);
+                index.add(st_name, sym.st_value, sym.st_size, st_type, SymbolIndex::SOURCE_SYMTAB);
+            }
+        }
+    }
+
+    index.finalize();
+    LOGD("froze {} symbols of {}", index.size(), elfPath);
+    index_ = std::move(index);
+
+    // Keep MiniDebugInfo lazy by copying just the compressed section out of the mapping
+    if (!debugdata_.empty() && !debugdata_index_) {
+        debugdata_owned_.assign(debugdata_.begin(), debugdata_.end());
+        debugdata_ = debugdata_owned_;
+    }
+
+    // Everything below points into the mapping
+    symtabs_.clear();
+    munmap(header, size);
+    header = nullptr;
+    section_header = symtab = strtab = dynsym = nullptr;
+    symtab_start = dynsym_start = strtab_start = nullptr;
+    nbucket_ = 0;
+    bucket_ = chain_ = nullptr;
+    gnu_nbucket_ = 0;
+    gnu_bloom_filter_ = nullptr;
+    gnu_bucket_ = gnu_chain_ = nullptr;
+
+    return true;
 }
 
 ElfW(Addr) ElfImg::ElfLookup(std::string_view name, uint32_t hash) const {
@@ -187,16 +359,36 @@ void ElfImg::MayInitLinearMap() const {
     }
 }
 
+const SymbolIndex *ElfImg::MayLoadMiniDebugInfo() const {
+    if (debugdata_.empty()) return nullptr;
+
+    std::call_once(debugdata_once_, [this] {
+        LOGD("loading MiniDebugInfo of {}", elfPath);
+        debugdata_index_ = LoadMiniDebugInfo(debugdata_key_, debugdata_);
+    });
+    return debugdata_index_.get();
+}
+
 ElfW(Addr) ElfImg::LinearLookup(std::string_view name) const {
     MayInitLinearMap();
     if (auto i = symtabs_.find(name); i != symtabs_.end()) {
         return i->second->st_value;
+    } else if (auto *debugdata = MayLoadMiniDebugInfo()) {
+        return debugdata->lookup(name);
     } else {
         return 0;
     }
 }
 
 std::vector<ElfW(Addr)> ElfImg::LinearRangeLookup(std::string_view name) const {
+    if (index_) {
+        auto res = index_->rangeLookup(name, SymbolIndex::SOURCE_SYMTAB);
+        if (auto *debugdata = MayLoadMiniDebugInfo(); res.empty() && debugdata) {
+            res = debugdata->rangeLookup(name, SymbolIndex::SOURCE_SYMTAB);
+        }
+        return res;
+    }
+
     MayInitLinearMap();
     std::vector<ElfW(Addr)> res;
     for (auto [i, end] = symtabs_.equal_range(name); i != end; ++i) {
@@ -204,14 +396,30 @@ std::vector<ElfW(Addr)> ElfImg::LinearRangeLookup(std::string_view name) const {
         res.emplace_back(offset);
         LOGD("found {} {:#x} in {} in symtab by linear range lookup", name, offset, elfPath);
     }
+    if (res.empty()) {
+        if (auto *debugdata = MayLoadMiniDebugInfo()) {
+            res = debugdata->rangeLookup(name, SymbolIndex::SOURCE_SYMTAB);
+        }
+    }
     return res;
 }
 
 ElfW(Addr) ElfImg::PrefixLookupFirst(std::string_view prefix) const {
+    if (index_) {
+        if (auto offset = index_->prefixLookupFirst(prefix, SymbolIndex::SOURCE_SYMTAB); offset > 0) {
+            return offset;
+        } else if (auto *debugdata = MayLoadMiniDebugInfo()) {
+            return debugdata->prefixLookupFirst(prefix, SymbolIndex::SOURCE_SYMTAB);
+        }
+        return 0;
+    }
+
     MayInitLinearMap();
     if (auto i = symtabs_.lower_bound(prefix); i != symtabs_.end() && i->first.starts_with(prefix)) {
         LOGD("found prefix {} of {} {:#x} in {} in symtab by linear lookup", prefix, i->first, i->second->st_value, elfPath);
         return i->second->st_value;
+    } else if (auto *debugdata = MayLoadMiniDebugInfo()) {
+        return debugdata->prefixLookupFirst(prefix, SymbolIndex::SOURCE_SYMTAB);
     } else {
         return 0;
     }
@@ -233,6 +441,17 @@ ElfImg::~ElfImg() {
 
 ElfW(Addr)
 ElfImg::getSymbOffset(std::string_view name, uint32_t gnu_hash, uint32_t elf_hash) const {
+    if (index_) {
+        if (auto offset = index_->lookup(name); offset > 0) {
+            LOGD("found {} {:#x} in {} in frozen index", name, offset, elfPath);
+            return offset;
+        } else if (auto *debugdata = MayLoadMiniDebugInfo(); debugdata && (offset = debugdata->lookup(name)) > 0) {
+            LOGD("found {} {:#x} in {} in MiniDebugInfo", name, offset, elfPath);
+            return offset;
+        }
+        return 0;
+    }
+
     if (auto offset = GnuLookup(name, gnu_hash); offset > 0) {
         LOGD("found {} {:#x} in {} in dynsym by gnuhash", name, offset, elfPath);
         return offset;
@@ -248,14 +467,63 @@ ElfImg::getSymbOffset(std::string_view name, uint32_t gnu_hash, uint32_t elf_has
 }
 
 bool ElfImg::findModuleBase() {
-    std::vector<proc_map_t> maps;
-    proc_map_t *foundMap = nullptr;
-
-    if (!proc_map_parse(maps)) {
+    bool refreshed = false;
+    auto maps = proc_map_snapshot(false, &refreshed);
+    if (!maps) {
         LOGE("failed to open or parse /proc/self/maps");
         return false;
     }
 
+    auto name = elfPath;
+    if (findModuleBase(*maps)) {
+        if (refreshed || isMappingCurrent(*maps))
+            return true;
+
+        LOGD("cached map for {} is stale", name);
+        elfPath = name;
+        elfFileOffset = 0;
+        size = 0;
+        base = nullptr;
+    }
+
+    // The cached snapshot may predate a mapping that wasn't made through the dynamic linker
+    if (!refreshed) {
+        LOGD("did not find module {} in cached maps, rescanning", elfPath);
+        maps = proc_map_snapshot(true);
+        if (maps && findModuleBase(*maps))
+            return true;
+    }
+
+    LOGE("did not find module {}", elfPath);
+    return false;
+}
+
+bool ElfImg::isMappingCurrent(const std::vector<proc_map_t> &maps) const {
+    // Without PROCMAP_QUERY this would mean reparsing the whole maps file, which the snapshot exists to avoid
+    if (!proc_map_query_supported())
+        return true;
+
+    auto cached = std::ranges::find(maps, base, &proc_map_t::address_start);
+    proc_map_t current;
+    return cached != maps.end()
+           && proc_map_query(base, current)
+           && current.address_start == cached->address_start
+           && current.offset == cached->offset
+           && current.inode == cached->inode;
+}
+
+bool ElfImg::isStillMapped() const {
+    proc_map_t current;
+    return base != nullptr
+           && proc_map_query(base, current)
+           && current.address_start == baseMap_.address_start
+           && current.offset == baseMap_.offset
+           && current.inode == baseMap_.inode;
+}
+
+bool ElfImg::findModuleBase(const std::vector<proc_map_t> &maps) {
+    const proc_map_t *foundMap = nullptr;
+
     for (auto &map: maps) {
         if ((map.flags & PROC_MAP_WRITE) != 0)
             continue;
@@ -339,13 +607,12 @@ bool ElfImg::findModuleBase() {
         }
     }
 
-    if (!foundMap) {
-        LOGE("did not find module {}", elfPath);
+    if (!foundMap)
         return false;
-    }
 
     LOGD("got module base {}: {:#x}", elfPath, reinterpret_cast<uint64_t>(foundMap->address_start));
     base = foundMap->address_start;
+    baseMap_ = *foundMap;
 
     return true;
 }
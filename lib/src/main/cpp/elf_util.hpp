@@ -22,13 +22,22 @@
 
 #include <string_view>
 #include <map>
+#include <mutex>
+#include <optional>
+#include <span>
 #include <linux/elf.h>
 #include <sys/types.h>
 #include <link.h>
 #include <vector>
+#include "proc_maps.hpp"
+#include "symbol_index.hpp"
 
 #define SHT_GNU_HASH 0x6ffffff6
 
+#ifndef NT_GNU_BUILD_ID
+#define NT_GNU_BUILD_ID 3
+#endif
+
 namespace SandHook {
     class ElfImg {
     public:
@@ -36,6 +45,12 @@ namespace SandHook {
 
         explicit ElfImg(std::string_view elf);
 
+        /**
+         * Locates an already loaded module and uses a previously frozen symbol index for it instead of mapping its file.
+         * The image is invalid if the index was frozen from a different build of the module.
+         */
+        ElfImg(std::string_view elf, SymbolIndex index);
+
         template<typename T = void *>
         requires(std::is_pointer_v<T>)
         constexpr const T getSymbAddress(std::string_view name) const {
@@ -78,6 +93,25 @@ namespace SandHook {
             return elfPath;
         }
 
+        /**
+         * Copies all symbols into a compact owned index and unmaps the ELF file.
+         * Lookups keep working afterward, but no longer pin the file mapping.
+         */
+        bool freeze();
+
+        bool isFrozen() const {
+            return index_.has_value();
+        }
+
+        const SymbolIndex *symbolIndex() const {
+            return index_ ? &*index_ : nullptr;
+        }
+
+        /**
+         * Whether the module is still mapped at the same base from the same file, e.g. it has not been unloaded.
+         */
+        bool isStillMapped() const;
+
         ~ElfImg();
 
     private:
@@ -99,10 +133,19 @@ namespace SandHook {
 
         bool findModuleBase();
 
+        bool findModuleBase(const std::vector<proc_map_t> &maps);
+
+        bool isMappingCurrent(const std::vector<proc_map_t> &maps) const;
+
         void MayInitLinearMap() const;
 
+        const SymbolIndex *MayLoadMiniDebugInfo() const;
+
+        void setDebugDataKey();
+
         std::string elfPath;
         size_t elfFileOffset;
+        proc_map_t baseMap_;
         void *base = nullptr;
         char *buffer = nullptr;
         off_t size = 0;
@@ -135,6 +178,15 @@ namespace SandHook {
         uint32_t *gnu_chain_;
 
         mutable std::map<std::string_view, ElfW(Sym) *> symtabs_;
+
+        std::optional<SymbolIndex> index_;
+        SymbolIndex::Identity identity_;
+
+        std::string debugdata_key_;
+        std::span<const uint8_t> debugdata_;
+        std::vector<uint8_t> debugdata_owned_;
+        mutable std::once_flag debugdata_once_;
+        mutable std::shared_ptr<const SymbolIndex> debugdata_index_;
     };
 
     constexpr uint32_t ElfImg::ElfHash(std::string_view name) {
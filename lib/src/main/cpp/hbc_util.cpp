@@ -0,0 +1,153 @@
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "hbc_util.hpp"
+
+// https://github.com/discord/hermes/blob/0.76.2-discord/include/hermes/BCGen/HBC/BytecodeFileFormat.h
+static constexpr uint64_t HBC_MAGIC = 0x1F1903C103BC1FC6;
+static constexpr size_t HBC_SHA1_SIZE = 20;
+static constexpr size_t HBC_ALIGNMENT = alignof(uint32_t);
+
+// Oldest bytecode version known to use the header layout below (with BigInt tables)
+static constexpr uint32_t HBC_MIN_LAYOUT_VERSION = 87;
+
+struct hbc_file_header_t {
+    uint64_t magic;
+    uint32_t version;
+    uint8_t source_hash[HBC_SHA1_SIZE];
+    uint32_t file_length;
+    uint32_t global_code_index;
+    uint32_t function_count;
+    uint32_t string_kind_count;
+    uint32_t identifier_count;
+    uint32_t string_count;
+    uint32_t overflow_string_count;
+    uint32_t string_storage_size;
+    uint32_t bigint_count;
+    uint32_t bigint_storage_size;
+    uint32_t regexp_count;
+    uint32_t regexp_storage_size;
+    uint32_t array_buffer_size;
+    uint32_t obj_key_buffer_size;
+    uint32_t obj_value_buffer_size;
+    uint32_t segment_id;
+    uint32_t cjs_module_count;
+    uint32_t function_source_count;
+    uint32_t debug_info_offset;
+    uint8_t options;
+    uint8_t padding[19];
+};
+
+static_assert(sizeof(hbc_file_header_t) == 128);
+static_assert(offsetof(hbc_file_header_t, file_length) == 32);
+
+/**
+ * Computes where the sections following the header end, in the order Hermes lays them out.
+ */
+static uint64_t hbc_sections_end(const hbc_file_header_t &h) {
+    const uint64_t sections[][2] = {
+            // {count, entry size}
+            {h.function_count, 16},
+            {h.string_kind_count, 4},
+            {h.identifier_count, 4},
+            {h.string_count, 4},
+            {h.overflow_string_count, 8},
+            {h.string_storage_size, 1},
+            {h.array_buffer_size, 1},
+            {h.obj_key_buffer_size, 1},
+            {h.obj_value_buffer_size, 1},
+            {h.bigint_count, 8},
+            {h.bigint_storage_size, 1},
+            {h.regexp_count, 8},
+            {h.regexp_storage_size, 1},
+            {h.cjs_module_count, 8},
+            {h.function_source_count, 8},
+    };
+
+    uint64_t end = sizeof(hbc_file_header_t);
+    for (const auto &[count, size]: sections) {
+        end = (end + HBC_ALIGNMENT - 1) & ~(HBC_ALIGNMENT - 1);
+        end += count * size;
+    }
+    return end;
+}
+
+bool hbc_inspect(std::span<const uint8_t> data, hbc_bundle_info_t &info) {
+    uint64_t magic;
+    if (data.size() < sizeof(magic)) return false;
+    memcpy(&magic, data.data(), sizeof(magic));
+    if (magic != HBC_MAGIC) return false;
+
+    info = {};
+    info.actual_length = data.size();
+
+    // Too short to even hold the header, report whatever is present
+    if (data.size() < sizeof(hbc_file_header_t)) {
+        if (data.size() >= offsetof(hbc_file_header_t, version) + sizeof(uint32_t)) {
+            memcpy(&info.version, data.data() + offsetof(hbc_file_header_t, version), sizeof(uint32_t));
+        }
+        info.truncated = true;
+        return true;
+    }
+
+    hbc_file_header_t h;
+    memcpy(&h, data.data(), sizeof(h));
+
+    info.version = h.version;
+    info.file_length = h.file_length;
+    info.function_count = h.function_count;
+    info.truncated = data.size() < h.file_length;
+
+    if (h.version < HBC_MIN_LAYOUT_VERSION)
+        return true;
+
+    info.string_count = h.string_count;
+    info.identifier_count = h.identifier_count;
+    info.string_storage_size = h.string_storage_size;
+    info.bigint_count = h.bigint_count;
+    info.bigint_storage_size = h.bigint_storage_size;
+    info.regexp_count = h.regexp_count;
+    info.cjs_module_count = h.cjs_module_count;
+
+    // The file ends with a SHA1 footer of everything before it
+    info.layout_valid = h.file_length >= sizeof(h) + HBC_SHA1_SIZE
+                        && hbc_sections_end(h) <= h.file_length - HBC_SHA1_SIZE
+                        && h.debug_info_offset <= h.file_length - HBC_SHA1_SIZE;
+    return true;
+}
+
+int hbc_inspect_fd(int fd, hbc_bundle_info_t &info) {
+    struct stat st{};
+    if (fstat(fd, &st) != 0) return -1;
+
+    // Empty files and non-regular files like pipes can't be mapped
+    if (st.st_size <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) return -1;
+
+    bool isHBC = hbc_inspect({static_cast<const uint8_t *>(data), static_cast<size_t>(st.st_size)}, info);
+
+    munmap(data, st.st_size);
+    return isHBC ? 1 : 0;
+}
+
+int hbc_inspect_path(const char *path, hbc_bundle_info_t &info) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+
+    int res = hbc_inspect_fd(fd, info);
+
+    // Keep the error of the failed fstat() or mmap() for the caller
+    int error = errno;
+    close(fd);
+    errno = error;
+    return res;
+}
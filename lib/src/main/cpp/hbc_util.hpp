@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+struct hbc_bundle_info_t {
+    uint32_t version;
+    /* Length of the bundle according to its header */
+    uint64_t file_length;
+    /* Length of the bundle on disk */
+    uint64_t actual_length;
+    uint32_t function_count;
+    uint32_t string_count;
+    uint32_t identifier_count;
+    uint32_t string_storage_size;
+    uint32_t bigint_count;
+    uint32_t bigint_storage_size;
+    uint32_t regexp_count;
+    uint32_t cjs_module_count;
+    /* Whether the bundle is shorter than its header claims */
+    bool truncated;
+    /* Whether the header layout for this version is known and all sections fit within the bundle's length */
+    bool layout_valid;
+};
+
+/**
+ * Parses the file header and section layout of a Hermes bytecode bundle in place.
+ * Only the header itself is read, none of the section contents are touched.
+ * @return false if the data is not a Hermes bytecode bundle.
+ */
+bool hbc_inspect(std::span<const uint8_t> data, hbc_bundle_info_t &info);
+
+/**
+ * Maps a bundle from an open file descriptor and inspects it. The fd is not closed.
+ * @return -1 with errno set if the file could not be mapped (EINVAL if it is empty or not a regular file),
+ *         0 if it is not a Hermes bytecode bundle, 1 on success.
+ */
+int hbc_inspect_fd(int fd, hbc_bundle_info_t &info);
+
+/**
+ * Maps a bundle from a path and inspects it.
+ * @return -1 with errno set if the file could not be opened or mapped, 0 if it is not a Hermes bytecode bundle,
+ *         1 on success.
+ */
+int hbc_inspect_path(const char *path, hbc_bundle_info_t &info);
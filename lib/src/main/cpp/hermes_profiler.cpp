@@ -0,0 +1,97 @@
+#include <exception>
+#include <optional>
+#include "hermes_profiler.hpp"
+#include "logging.hpp"
+
+// Optional symbols, these are not present in every Hermes build
+static std::optional<void (*)(double meanHzFreq)> HERMES_enableSamplingProfiler;
+static std::optional<void (*)()> HERMES_enableSamplingProfilerLegacy;
+static std::optional<void (*)()> HERMES_disableSamplingProfiler;
+static std::optional<void (*)(const std::string &fileName)> HERMES_dumpSampledTraceToFile;
+
+template<typename T>
+static void resolveOptional(const SandHook::ElfImg &img, std::optional<T> &out, std::string_view symbol) {
+    if (auto address = img.getSymbAddress<T>(symbol)) {
+        out = address;
+    } else {
+        LOGW("Failed to find optional native symbol {}", symbol);
+    }
+}
+
+/**
+ * Describes the exception currently being handled.
+ */
+static std::string currentExceptionMessage() {
+    try {
+        throw;
+    } catch (const std::exception &e) {
+        return e.what();
+    } catch (...) {
+        return "unknown exception";
+    }
+}
+
+void hermes_profiler_resolve(const SandHook::ElfImg &hermes) {
+    // https://github.com/discord/hermes/blob/0.76.2-discord/API/hermes/hermes.h
+    resolveOptional(hermes, HERMES_enableSamplingProfiler,
+                    "_ZN8facebook6hermes13HermesRuntime22enableSamplingProfilerEd");
+    if (!HERMES_enableSamplingProfiler) {
+        // Older Hermes versions did not take a sampling frequency
+        resolveOptional(hermes, HERMES_enableSamplingProfilerLegacy,
+                        "_ZN8facebook6hermes13HermesRuntime22enableSamplingProfilerEv");
+    }
+    resolveOptional(hermes, HERMES_disableSamplingProfiler,
+                    "_ZN8facebook6hermes13HermesRuntime23disableSamplingProfilerEv");
+    resolveOptional(hermes, HERMES_dumpSampledTraceToFile,
+                    "_ZN8facebook6hermes13HermesRuntime22dumpSampledTraceToFileERKNSt6__ndk112basic_stringIcNS2_11char_traitsIcEENS2_9allocatorIcEEEE");
+}
+
+bool hermes_profiler_supported() {
+    return (HERMES_enableSamplingProfiler || HERMES_enableSamplingProfilerLegacy)
+           && HERMES_disableSamplingProfiler
+           && HERMES_dumpSampledTraceToFile;
+}
+
+// Hermes reports failures (even a build without profiler support) as C++ exceptions,
+// which must not unwind through the JNI frames calling these
+
+bool hermes_profiler_enable(double mean_hz) {
+    try {
+        if (HERMES_enableSamplingProfiler) {
+            (*HERMES_enableSamplingProfiler)(mean_hz);
+        } else if (HERMES_enableSamplingProfilerLegacy) {
+            LOGW("Hermes does not support a custom sampling frequency, ignoring {}Hz", mean_hz);
+            (*HERMES_enableSamplingProfilerLegacy)();
+        } else {
+            return false;
+        }
+    } catch (...) {
+        LOGW("Failed to enable the sampling profiler: {}", currentExceptionMessage());
+        return false;
+    }
+    return true;
+}
+
+bool hermes_profiler_disable() {
+    if (!HERMES_disableSamplingProfiler) return false;
+
+    try {
+        (*HERMES_disableSamplingProfiler)();
+    } catch (...) {
+        LOGW("Failed to disable the sampling profiler: {}", currentExceptionMessage());
+        return false;
+    }
+    return true;
+}
+
+int hermes_profiler_dump(const std::string &path, std::string &error) {
+    if (!HERMES_dumpSampledTraceToFile) return 0;
+
+    try {
+        (*HERMES_dumpSampledTraceToFile)(path);
+    } catch (...) {
+        error = currentExceptionMessage();
+        return -1;
+    }
+    return 1;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include "elf_util.hpp"
+
+/**
+ * Resolves the optional static HermesRuntime sampling profiler entry points from an image of libhermes.
+ * Missing entry points are logged and leave the corresponding functions below unavailable.
+ */
+void hermes_profiler_resolve(const SandHook::ElfImg &hermes);
+
+/**
+ * Whether all sampling profiler entry points were found.
+ */
+bool hermes_profiler_supported();
+
+/**
+ * Starts the sampling profiler. Exceptions thrown by Hermes (e.g. when built without profiler support) are caught.
+ * @return false if the profiler is unavailable or could not be started.
+ */
+bool hermes_profiler_enable(double mean_hz);
+
+/**
+ * Stops the sampling profiler. Exceptions thrown by Hermes are caught.
+ * @return false if the profiler is unavailable or could not be stopped.
+ */
+bool hermes_profiler_disable();
+
+/**
+ * Writes the collected samples to a file in the Chrome trace format. Exceptions thrown by Hermes are caught.
+ * @param error Set to a description of the failure when -1 is returned.
+ * @return 1 on success, 0 if the profiler is unavailable, -1 if the trace could not be written.
+ */
+int hermes_profiler_dump(const std::string &path, std::string &error);
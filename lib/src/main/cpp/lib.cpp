@@ -1,11 +1,147 @@
 #include <jni.h>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <jsi/instrumentation.h>
+#include <jsi/jsi.h>
 #include "elf_util.hpp"
+#include "hbc_util.hpp"
+#include "hermes_profiler.hpp"
 #include "logging.hpp"
 
 static std::optional<uint32_t (*)()> HERMES_getBytecodeVersion;
 static std::optional<bool (*)(const uint8_t *data, size_t len)> HERMES_isHermesBytecode;
 
+static jclass HermesBundleInfo_class;
+static jmethodID HermesBundleInfo_init;
+
+struct CachedImage {
+    std::shared_ptr<const SandHook::ElfImg> img;
+    /* Module generation the image was last known to be mapped at */
+    proc_map_generation_t generation;
+};
+
+static std::mutex imagesLock;
+static std::unordered_map<std::string, CachedImage> images;
+/* Libraries that were not found, with the module generation they were looked up at */
+static std::unordered_map<std::string, proc_map_generation_t> missingImages;
+
+/**
+ * Gets a cached frozen image for a library, parsing it on first use.
+ * Frozen images don't keep the library file mapped and are safe to use from multiple threads.
+ * Images of libraries that have since been unloaded or replaced are rebuilt.
+ * @return nullptr if the library is not loaded, or was not loaded when last looked up and no module has been loaded since.
+ */
+static std::shared_ptr<const SandHook::ElfImg> getCachedImage(const std::string &library) {
+    std::lock_guard guard(imagesLock);
+
+    auto generation = proc_map_generation();
+    if (auto i = images.find(library); i != images.end()) {
+        // The mapping only needs to be rechecked once any module was loaded or unloaded
+        if (auto &cached = i->second; cached.generation == generation || cached.img->isStillMapped()) {
+            cached.generation = generation;
+            return cached.img;
+        }
+
+        LOGD("cached image of {} is no longer mapped, rebuilding", library);
+        images.erase(i);
+    }
+
+    // Looking up a missing library rescans all maps and apks, so only retry once a module has been loaded
+    if (auto i = missingImages.find(library); i != missingImages.end() && i->second == generation) {
+        return nullptr;
+    }
+
+    auto img = std::make_shared<SandHook::ElfImg>(library);
+    if (!img->isValid() || !img->freeze()) {
+        missingImages.insert_or_assign(library, generation);
+        return nullptr;
+    }
+
+    missingImages.erase(library);
+    images.emplace(library, CachedImage{.img = img, .generation = generation});
+    return img;
+}
+
+/**
+ * Caches an image for a library built from a previously serialized symbol index instead of parsing the library.
+ * @return false if the index is malformed, was made from a different build of the library, or it isn't loaded.
+ */
+static bool restoreCachedImage(const std::string &library, std::span<const uint8_t> data) {
+    auto index = SandHook::SymbolIndex::deserialize(data);
+    if (!index) return false;
+
+    auto generation = proc_map_generation();
+    auto img = std::make_shared<SandHook::ElfImg>(library, std::move(*index));
+    if (!img->isValid()) return false;
+
+    std::lock_guard guard(imagesLock);
+    missingImages.erase(library);
+    images.insert_or_assign(library, CachedImage{.img = img, .generation = generation});
+    return true;
+}
+
+/**
+ * Copies a Java string as modified UTF-8 into a reusable buffer, avoiding an allocation per string.
+ */
+static void getStringUTF(JNIEnv *env, jstring jStr, std::string &out) {
+    out.resize(env->GetStringUTFLength(jStr));
+    env->GetStringUTFRegion(jStr, 0, env->GetStringLength(jStr), out.data());
+}
+
+/**
+ * Resolves (library, symbol) pairs into out, which must fit count entries. Unresolved symbols are set to 0.
+ * @return The amount of symbols resolved.
+ */
+static jint resolveSymbols(JNIEnv *env, jobjectArray jLibraries, jobjectArray jSymbols, jlong *out, jsize count) {
+    jint resolved = 0;
+    jstring jLastLibrary = nullptr;
+    std::shared_ptr<const SandHook::ElfImg> img;
+    std::unordered_set<std::string> missingLibraries;
+    std::string library, symbol;
+
+    for (jsize i = 0; i < count; i++) {
+        auto jLibrary = static_cast<jstring>(env->GetObjectArrayElement(jLibraries, i));
+        auto jSymbol = static_cast<jstring>(env->GetObjectArrayElement(jSymbols, i));
+        out[i] = 0;
+
+        // Callers usually pass the same String instance for symbols in the same library
+        if (!jLibrary || !jLastLibrary || !env->IsSameObject(jLibrary, jLastLibrary)) {
+            if (jLastLibrary) env->DeleteLocalRef(jLastLibrary);
+            jLastLibrary = jLibrary;
+            img = nullptr;
+
+            // Avoids even checking the cache again for a missing library within this call
+            if (jLibrary) {
+                getStringUTF(env, jLibrary, library);
+                if (!missingLibraries.contains(library) && !(img = getCachedImage(library))) {
+                    missingLibraries.insert(library);
+                }
+            }
+        } else {
+            env->DeleteLocalRef(jLibrary);
+        }
+
+        if (img && jSymbol) {
+            getStringUTF(env, jSymbol, symbol);
+            if (auto address = img->getSymbAddress(symbol)) {
+                out[i] = static_cast<jlong>(reinterpret_cast<uintptr_t>(address));
+                resolved++;
+            }
+        }
+
+        if (jSymbol) env->DeleteLocalRef(jSymbol);
+    }
+
+    if (jLastLibrary) env->DeleteLocalRef(jLastLibrary);
+    return resolved;
+}
+
 extern "C" JNIEXPORT jint JNI_OnLoad([[maybe_unused]] JavaVM *vm, [[maybe_unused]] void *reserved) {
     JNIEnv *env;
     if (JNI_OK != vm->GetEnv(reinterpret_cast<void **>(&env), JNI_VERSION_1_6)) {
@@ -13,6 +149,14 @@ extern "C" JNIEXPORT jint JNI_OnLoad([[maybe_unused]] JavaVM *vm, [[maybe_unused
         return JNI_ERR;
     }
 
+    // Cached so that inspecting bundles doesn't look these up every time
+    jclass bundleInfoClass = env->FindClass("dev/rushii/libunbound/HermesBundleInfo");
+    if (!bundleInfoClass) return JNI_ERR;
+    HermesBundleInfo_class = static_cast<jclass>(env->NewGlobalRef(bundleInfoClass));
+    HermesBundleInfo_init = env->GetMethodID(HermesBundleInfo_class, "<init>", "(IJJIIIIIIIIZZZ)V");
+    if (!HermesBundleInfo_init) return JNI_ERR;
+    env->DeleteLocalRef(bundleInfoClass);
+
     // Open and parse symbols of libhermes
     SandHook::ElfImg hermes("libhermes.so");
     if (!hermes.isValid()) {
@@ -43,6 +187,8 @@ extern "C" JNIEXPORT jint JNI_OnLoad([[maybe_unused]] JavaVM *vm, [[maybe_unused
     }
     HERMES_isHermesBytecode = isHermesBytecode;
 
+    hermes_profiler_resolve(hermes);
+
     LOGI("LibUnbound loaded!");
     return JNI_VERSION_1_6;
 }
@@ -91,3 +237,243 @@ extern "C" JNIEXPORT jboolean Java_dev_rushii_libunbound_LibUnbound_isHermesByte
     env->ReleaseByteArrayElements(jBytes, bytes, 0);
     return isHBC;
 }
+
+extern "C" JNIEXPORT jboolean Java_dev_rushii_libunbound_LibUnbound_isSamplingProfilerSupported0(
+        [[maybe_unused]] JNIEnv *env,
+        [[maybe_unused]] jclass clazz
+) {
+    return hermes_profiler_supported();
+}
+
+extern "C" JNIEXPORT jboolean Java_dev_rushii_libunbound_LibUnbound_enableSamplingProfiler0(
+        [[maybe_unused]] JNIEnv *env,
+        [[maybe_unused]] jclass clazz,
+        jdouble meanHzFreq
+) {
+    return hermes_profiler_enable(meanHzFreq);
+}
+
+extern "C" JNIEXPORT jboolean Java_dev_rushii_libunbound_LibUnbound_disableSamplingProfiler0(
+        [[maybe_unused]] JNIEnv *env,
+        [[maybe_unused]] jclass clazz
+) {
+    return hermes_profiler_disable();
+}
+
+extern "C" JNIEXPORT jboolean Java_dev_rushii_libunbound_LibUnbound_dumpSampledTraceToFile0(
+        JNIEnv *env,
+        [[maybe_unused]] jclass clazz,
+        jstring jPath
+) {
+    const char *path = env->GetStringUTFChars(jPath, nullptr);
+    if (!path) return false;
+
+    std::string fileName(path);
+    env->ReleaseStringUTFChars(jPath, path);
+
+    std::string error;
+    int res = hermes_profiler_dump(fileName, error);
+    if (res < 0) {
+        env->ThrowNew(env->FindClass("java/io/IOException"), error.c_str());
+    }
+    return res > 0;
+}
+
+/**
+ * Rethrows the C++ exception currently being handled as a Java RuntimeException.
+ */
+static void throwCurrentException(JNIEnv *env) {
+    try {
+        throw;
+    } catch (const std::exception &e) {
+        env->ThrowNew(env->FindClass("java/lang/RuntimeException"), e.what());
+    } catch (...) {
+        env->ThrowNew(env->FindClass("java/lang/RuntimeException"), "Unknown native exception");
+    }
+}
+
+extern "C" JNIEXPORT jobject Java_dev_rushii_libunbound_LibUnbound_getHeapInfo0(
+        JNIEnv *env,
+        [[maybe_unused]] jclass clazz,
+        jlong runtimePtr,
+        jboolean includeExpensive
+) {
+    auto *runtime = reinterpret_cast<facebook::jsi::Runtime *>(runtimePtr);
+
+    // Exceptions thrown by the runtime must not unwind through this JNI frame
+    std::unordered_map<std::string, int64_t> heapInfo;
+    try {
+        heapInfo = runtime->instrumentation().getHeapInfo(includeExpensive);
+    } catch (...) {
+        throwCurrentException(env);
+        return nullptr;
+    }
+
+    jclass mapClass = env->FindClass("java/util/HashMap");
+    jclass longClass = env->FindClass("java/lang/Long");
+    jmethodID mapInit = env->GetMethodID(mapClass, "<init>", "(I)V");
+    jmethodID mapPut = env->GetMethodID(mapClass, "put", "(Ljava/lang/Object;Ljava/lang/Object;)Ljava/lang/Object;");
+    jmethodID longValueOf = env->GetStaticMethodID(longClass, "valueOf", "(J)Ljava/lang/Long;");
+
+    jobject map = env->NewObject(mapClass, mapInit, static_cast<jint>(heapInfo.size() * 2));
+    for (const auto &[name, value]: heapInfo) {
+        jstring jName = env->NewStringUTF(name.c_str());
+        jobject jValue = env->CallStaticObjectMethod(longClass, longValueOf, static_cast<jlong>(value));
+        env->DeleteLocalRef(env->CallObjectMethod(map, mapPut, jName, jValue));
+        env->DeleteLocalRef(jName);
+        env->DeleteLocalRef(jValue);
+    }
+
+    env->DeleteLocalRef(mapClass);
+    env->DeleteLocalRef(longClass);
+    return map;
+}
+
+extern "C" JNIEXPORT jstring Java_dev_rushii_libunbound_LibUnbound_getRecordedGCStats0(
+        JNIEnv *env,
+        [[maybe_unused]] jclass clazz,
+        jlong runtimePtr
+) {
+    auto *runtime = reinterpret_cast<facebook::jsi::Runtime *>(runtimePtr);
+
+    std::string stats;
+    try {
+        stats = runtime->instrumentation().getRecordedGCStats();
+    } catch (...) {
+        throwCurrentException(env);
+        return nullptr;
+    }
+
+    return env->NewStringUTF(stats.c_str());
+}
+
+extern "C" JNIEXPORT jint Java_dev_rushii_libunbound_LibUnbound_resolveSymbols0(
+        JNIEnv *env,
+        [[maybe_unused]] jclass clazz,
+        jobjectArray jLibraries,
+        jobjectArray jSymbols,
+        jlongArray jOut
+) {
+    jsize count = env->GetArrayLength(jSymbols);
+    std::vector<jlong> addresses(count);
+
+    jint resolved = resolveSymbols(env, jLibraries, jSymbols, addresses.data(), count);
+
+    env->SetLongArrayRegion(jOut, 0, count, addresses.data());
+    return resolved;
+}
+
+extern "C" JNIEXPORT jint Java_dev_rushii_libunbound_LibUnbound_resolveSymbolsDirect0(
+        JNIEnv *env,
+        [[maybe_unused]] jclass clazz,
+        jobjectArray jLibraries,
+        jobjectArray jSymbols,
+        jobject jOut
+) {
+    auto *out = static_cast<jlong *>(env->GetDirectBufferAddress(jOut));
+    if (!out) {
+        env->ThrowNew(env->FindClass("java/lang/IllegalArgumentException"), "LongBuffer is not direct");
+        return 0;
+    }
+
+    return resolveSymbols(env, jLibraries, jSymbols, out, env->GetArrayLength(jSymbols));
+}
+
+extern "C" JNIEXPORT jbyteArray Java_dev_rushii_libunbound_LibUnbound_exportSymbolIndex0(
+        JNIEnv *env,
+        [[maybe_unused]] jclass clazz,
+        jstring jLibrary
+) {
+    std::string library;
+    getStringUTF(env, jLibrary, library);
+
+    auto img = getCachedImage(library);
+    if (!img) return nullptr;
+
+    auto data = img->symbolIndex()->serialize();
+    jbyteArray jData = env->NewByteArray(static_cast<jsize>(data.size()));
+    if (!jData) return nullptr;
+
+    env->SetByteArrayRegion(jData, 0, static_cast<jsize>(data.size()), reinterpret_cast<const jbyte *>(data.data()));
+    return jData;
+}
+
+extern "C" JNIEXPORT jboolean Java_dev_rushii_libunbound_LibUnbound_importSymbolIndex0(
+        JNIEnv *env,
+        [[maybe_unused]] jclass clazz,
+        jstring jLibrary,
+        jbyteArray jData
+) {
+    std::string library;
+    getStringUTF(env, jLibrary, library);
+
+    jsize length = env->GetArrayLength(jData);
+    jbyte *data = env->GetByteArrayElements(jData, nullptr);
+    if (!data) {
+        env->ThrowNew(env->FindClass("java/lang/RuntimeException"), "Failed to obtain jByteArray");
+        return false;
+    }
+
+    bool restored = restoreCachedImage(library, {reinterpret_cast<const uint8_t *>(data), static_cast<size_t>(length)});
+
+    env->ReleaseByteArrayElements(jData, data, JNI_ABORT);
+    return restored;
+}
+
+static jobject newHermesBundleInfo(JNIEnv *env, const hbc_bundle_info_t &info) {
+    bool matchesRuntime = HERMES_getBytecodeVersion && info.version == (*HERMES_getBytecodeVersion)();
+
+    return env->NewObject(
+            HermesBundleInfo_class, HermesBundleInfo_init,
+            static_cast<jint>(info.version),
+            static_cast<jlong>(info.file_length),
+            static_cast<jlong>(info.actual_length),
+            static_cast<jint>(info.function_count),
+            static_cast<jint>(info.string_count),
+            static_cast<jint>(info.identifier_count),
+            static_cast<jint>(info.string_storage_size),
+            static_cast<jint>(info.bigint_count),
+            static_cast<jint>(info.bigint_storage_size),
+            static_cast<jint>(info.regexp_count),
+            static_cast<jint>(info.cjs_module_count),
+            static_cast<jboolean>(info.truncated),
+            static_cast<jboolean>(info.layout_valid),
+            static_cast<jboolean>(matchesRuntime)
+    );
+}
+
+static jobject inspectHermesBundleResult(JNIEnv *env, int res, int error, const hbc_bundle_info_t &info) {
+    if (res < 0) {
+        env->ThrowNew(env->FindClass("java/io/IOException"), strerror(error));
+        return nullptr;
+    } else if (res == 0) {
+        return nullptr;
+    }
+    return newHermesBundleInfo(env, info);
+}
+
+extern "C" JNIEXPORT jobject Java_dev_rushii_libunbound_LibUnbound_inspectHermesBundle0(
+        JNIEnv *env,
+        [[maybe_unused]] jclass clazz,
+        jstring jPath
+) {
+    const char *path = env->GetStringUTFChars(jPath, nullptr);
+    if (!path) return nullptr;
+
+    hbc_bundle_info_t info;
+    int res = hbc_inspect_path(path, info);
+    int error = errno;
+
+    env->ReleaseStringUTFChars(jPath, path);
+    return inspectHermesBundleResult(env, res, error, info);
+}
+
+extern "C" JNIEXPORT jobject Java_dev_rushii_libunbound_LibUnbound_inspectHermesBundleFd0(
+        JNIEnv *env,
+        [[maybe_unused]] jclass clazz,
+        jint fd
+) {
+    hbc_bundle_info_t info;
+    int res = hbc_inspect_fd(fd, info);
+    return inspectHermesBundleResult(env, res, errno, info);
+}
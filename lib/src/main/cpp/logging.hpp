@@ -21,7 +21,9 @@
 #ifndef _LOGGING_H
 #define _LOGGING_H
 
+#ifndef LOG_DISABLED
 #include <android/log.h>
+#endif
 #include <format>
 #include <array>
 
@@ -0,0 +1,356 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <linux/elf.h>
+#include <xz.h>
+#include "logging.hpp"
+#include "minidebuginfo.hpp"
+
+using namespace SandHook;
+
+namespace {
+    // Largest LZMA2 dictionary accepted, xz -9 uses 64MiB
+    constexpr uint32_t XZ_DICT_MAX = 1 << 26;
+    constexpr size_t XZ_CHUNK_SIZE = 16 * 1024;
+    // Largest .strtab that is copied when it precedes the .symtab
+    constexpr size_t XZ_STRTAB_COPY_MAX = 1 << 26;
+
+    /**
+     * Receives a chunk of decompressed output and the offset it starts at.
+     * @return false to stop decompressing early.
+     */
+    using ChunkSink = bool (*)(void *data, uint64_t offset, std::span<const uint8_t> chunk);
+
+    /**
+     * Streams the decompressed contents of an xz file through a sink in fixed size chunks.
+     */
+    bool Decompress(std::span<const uint8_t> compressed, void *data, ChunkSink sink) {
+        static std::once_flag crc_init;
+        std::call_once(crc_init, [] {
+            xz_crc32_init();
+            xz_crc64_init();
+        });
+
+        auto *dec = xz_dec_init(XZ_DYNALLOC, XZ_DICT_MAX);
+        if (!dec) return false;
+
+        std::array<uint8_t, XZ_CHUNK_SIZE> out;
+        xz_buf buf{
+                .in = compressed.data(),
+                .in_pos = 0,
+                .in_size = compressed.size(),
+                .out = out.data(),
+                .out_pos = 0,
+                .out_size = out.size(),
+        };
+
+        uint64_t offset = 0;
+        bool success = false;
+        while (true) {
+            auto ret = xz_dec_run(dec, &buf);
+
+            if (buf.out_pos > 0) {
+                if (!sink(data, offset, {out.data(), buf.out_pos})) {
+                    success = true;
+                    break;
+                }
+                offset += buf.out_pos;
+                buf.out_pos = 0;
+            }
+
+            if (ret == XZ_STREAM_END) {
+                success = true;
+                break;
+            } else if (ret != XZ_OK && ret != XZ_UNSUPPORTED_CHECK) {
+                LOGW("failed to decompress MiniDebugInfo: {}", static_cast<int>(ret));
+                break;
+            }
+        }
+
+        xz_dec_end(dec);
+        return success;
+    }
+
+    /**
+     * Copies the part of a chunk overlapping [start, start + dest.size()) into the same position in dest.
+     * @return Whether the end of the range has been reached.
+     */
+    bool CopyOverlap(uint64_t offset, std::span<const uint8_t> chunk, uint64_t start, std::span<uint8_t> dest) {
+        auto end = start + dest.size();
+        auto from = std::max(offset, start);
+        auto to = std::min(offset + chunk.size(), end);
+        if (from < to) {
+            memcpy(dest.data() + (from - start), chunk.data() + (from - offset), to - from);
+        }
+        return offset + chunk.size() >= end;
+    }
+
+    struct Headers {
+        ElfW(Ehdr) ehdr{};
+        std::vector<ElfW(Shdr)> shdrs;
+        bool valid = false;
+    };
+
+    bool ReadHeaders(void *data, uint64_t offset, std::span<const uint8_t> chunk) {
+        auto &headers = *static_cast<Headers *>(data);
+        auto ehdr_bytes = std::span{reinterpret_cast<uint8_t *>(&headers.ehdr), sizeof(headers.ehdr)};
+
+        if (headers.shdrs.empty()) {
+            if (!CopyOverlap(offset, chunk, 0, ehdr_bytes))
+                return true;
+
+            auto &ehdr = headers.ehdr;
+            if (memcmp(ehdr.e_ident, ELFMAG, SELFMAG) != 0
+                || ehdr.e_ident[EI_CLASS] != (sizeof(ElfW(Addr)) == 8 ? ELFCLASS64 : ELFCLASS32)
+                || ehdr.e_shentsize != sizeof(ElfW(Shdr))
+                || ehdr.e_shnum == 0
+                || ehdr.e_shoff < sizeof(ehdr)) {
+                LOGW("MiniDebugInfo is not a valid ELF for this ABI");
+                return false;
+            }
+            headers.shdrs.resize(ehdr.e_shnum);
+        }
+
+        auto shdr_bytes = std::span{reinterpret_cast<uint8_t *>(headers.shdrs.data()), headers.shdrs.size() * sizeof(ElfW(Shdr))};
+        if (!CopyOverlap(offset, chunk, headers.ehdr.e_shoff, shdr_bytes))
+            return true;
+
+        headers.valid = true;
+        return false;
+    }
+
+    struct PendingSymbol {
+        ElfW(Word) st_name;
+        ElfW(Addr) value;
+        uint32_t size;
+        uint8_t type;
+        uint32_t name_offset = 0;
+        uint32_t name_length = 0;
+        bool resolved = false;
+    };
+
+    /**
+     * Collects the function and object symbols of a streamed .symtab section.
+     */
+    class SymtabReader {
+    public:
+        SymtabReader(const ElfW(Shdr) &shdr, std::vector<PendingSymbol> &out) : shdr_(shdr), out_(out) {}
+
+        /**
+         * @return Whether the whole section has been read.
+         */
+        bool feed(uint64_t offset, std::span<const uint8_t> chunk) {
+            auto end = shdr_.sh_offset + shdr_.sh_size;
+            auto pos = std::max<uint64_t>(offset, shdr_.sh_offset);
+            auto to = std::min<uint64_t>(offset + chunk.size(), end);
+
+            // Symbols may straddle chunks, so assemble each one before parsing it
+            while (pos < to) {
+                auto n = std::min<uint64_t>(sizeof(partial_) - partial_len_, to - pos);
+                memcpy(reinterpret_cast<uint8_t *>(&partial_) + partial_len_, chunk.data() + (pos - offset), n);
+                partial_len_ += n;
+                pos += n;
+
+                if (partial_len_ == sizeof(partial_)) {
+                    partial_len_ = 0;
+                    unsigned int st_type = ELF_ST_TYPE(partial_.st_info);
+                    if ((st_type == STT_FUNC || st_type == STT_OBJECT) && partial_.st_size) {
+                        out_.push_back({
+                                .st_name = partial_.st_name,
+                                .value = partial_.st_value,
+                                .size = static_cast<uint32_t>(partial_.st_size),
+                                .type = static_cast<uint8_t>(st_type),
+                        });
+                    }
+                }
+            }
+
+            return offset + chunk.size() >= end;
+        }
+
+    private:
+        const ElfW(Shdr) &shdr_;
+        std::vector<PendingSymbol> &out_;
+        ElfW(Sym) partial_{};
+        size_t partial_len_ = 0;
+    };
+
+    /**
+     * Copies the names of symbols out of a streamed .strtab section.
+     * Only a window from the next unresolved name onward is kept, so strings shared between symbols still work.
+     */
+    class StrtabReader {
+    public:
+        StrtabReader(const ElfW(Shdr) &shdr, std::vector<PendingSymbol> &symbols, std::string &names)
+                : shdr_(shdr), symbols_(symbols), names_(names) {
+            std::ranges::sort(symbols_, {}, &PendingSymbol::st_name);
+        }
+
+        /**
+         * @return Whether all names have been resolved or the section has ended.
+         */
+        bool feed(uint64_t offset, std::span<const uint8_t> chunk) {
+            auto end = shdr_.sh_offset + shdr_.sh_size;
+            auto from = std::max<uint64_t>(offset, shdr_.sh_offset);
+            auto to = std::min<uint64_t>(offset + chunk.size(), end);
+
+            if (next_ < symbols_.size() && from < to) {
+                // Offsets from here on are relative to the section
+                from -= shdr_.sh_offset;
+                to -= shdr_.sh_offset;
+
+                if (window_.empty()) {
+                    window_start_ = std::max<uint64_t>(from, symbols_[next_].st_name);
+                    from = window_start_;
+                }
+                if (from < to) {
+                    window_.append(reinterpret_cast<const char *>(chunk.data()) + (from + shdr_.sh_offset - offset), to - from);
+                }
+
+                resolve();
+            }
+
+            return next_ >= symbols_.size() || offset + chunk.size() >= end;
+        }
+
+    private:
+        void resolve() {
+            for (; next_ < symbols_.size(); next_++) {
+                auto &symbol = symbols_[next_];
+                if (symbol.st_name < window_start_) continue; // Malformed
+                auto rel = symbol.st_name - window_start_;
+                if (rel >= window_.size()) break;
+
+                auto nul = window_.find('\0', rel);
+                if (nul == std::string::npos) break;
+
+                symbol.name_offset = static_cast<uint32_t>(names_.size());
+                symbol.name_length = static_cast<uint32_t>(nul - rel);
+                symbol.resolved = true;
+                names_.append(window_, rel, nul - rel);
+            }
+
+            // Drop everything before the next name that still needs to be resolved
+            if (next_ >= symbols_.size()) {
+                window_.clear();
+            } else {
+                auto drop = std::min<uint64_t>(symbols_[next_].st_name - window_start_, window_.size());
+                window_.erase(0, drop);
+                window_start_ += drop;
+            }
+        }
+
+        const ElfW(Shdr) &shdr_;
+        std::vector<PendingSymbol> &symbols_;
+        std::string &names_;
+        std::string window_;
+        uint64_t window_start_ = 0;
+        size_t next_ = 0;
+    };
+
+    struct SymbolsPass {
+        SymtabReader symtab;
+        std::optional<StrtabReader> strtab;
+        const ElfW(Shdr) &strtab_shdr;
+        std::vector<PendingSymbol> &symbols;
+        std::string &names;
+        /* Whether .strtab is copied, since names can only be resolved once all symbols are known */
+        bool copy_strtab = false;
+        std::vector<uint8_t> strtab_copy;
+        bool strtab_copied = false;
+        bool symtab_done = false;
+    };
+
+    /**
+     * Reads the .symtab and the .strtab in a single pass.
+     * If the .strtab comes after the .symtab it is streamed as well, otherwise only its bytes are copied.
+     */
+    bool ReadSymbols(void *data, uint64_t offset, std::span<const uint8_t> chunk) {
+        auto &pass = *static_cast<SymbolsPass *>(data);
+
+        if (pass.copy_strtab && !pass.strtab_copied)
+            pass.strtab_copied = CopyOverlap(offset, chunk, pass.strtab_shdr.sh_offset, pass.strtab_copy);
+
+        if (!pass.symtab_done && !(pass.symtab_done = pass.symtab.feed(offset, chunk)))
+            return true;
+
+        if (pass.copy_strtab)
+            return !pass.strtab_copied;
+
+        if (!pass.strtab)
+            pass.strtab.emplace(pass.strtab_shdr, pass.symbols, pass.names);
+        return !pass.strtab->feed(offset, chunk);
+    }
+
+    std::shared_ptr<const SymbolIndex> Decode(std::span<const uint8_t> compressed) {
+        Headers headers;
+        if (!Decompress(compressed, &headers, ReadHeaders) || !headers.valid)
+            return nullptr;
+
+        auto symtab = std::ranges::find(headers.shdrs, static_cast<ElfW(Word)>(SHT_SYMTAB), &ElfW(Shdr)::sh_type);
+        if (symtab == headers.shdrs.end()
+            || symtab->sh_entsize != sizeof(ElfW(Sym))
+            || symtab->sh_link >= headers.shdrs.size()
+            || headers.shdrs[symtab->sh_link].sh_type != SHT_STRTAB) {
+            LOGW("MiniDebugInfo does not contain a symtab");
+            return nullptr;
+        }
+        auto &strtab = headers.shdrs[symtab->sh_link];
+
+        std::vector<PendingSymbol> symbols;
+        std::string names;
+        SymbolsPass pass{
+                .symtab = SymtabReader(*symtab, symbols),
+                .strtab = std::nullopt,
+                .strtab_shdr = strtab,
+                .symbols = symbols,
+                .names = names,
+                .copy_strtab = strtab.sh_offset < symtab->sh_offset + symtab->sh_size,
+        };
+        if (pass.copy_strtab) {
+            if (strtab.sh_size > XZ_STRTAB_COPY_MAX) {
+                LOGW("MiniDebugInfo strtab is too large");
+                return nullptr;
+            }
+            pass.strtab_copy.resize(strtab.sh_size);
+            pass.strtab_copied = strtab.sh_size == 0;
+        }
+
+        if (!Decompress(compressed, &pass, ReadSymbols) || !pass.symtab_done)
+            return nullptr;
+
+        if (pass.copy_strtab) {
+            if (!pass.strtab_copied) return nullptr;
+            StrtabReader(strtab, symbols, names).feed(strtab.sh_offset, pass.strtab_copy);
+        }
+
+        auto index = std::make_shared<SymbolIndex>();
+        for (const auto &symbol: symbols) {
+            if (!symbol.resolved) continue;
+            index->add({names.data() + symbol.name_offset, symbol.name_length},
+                       symbol.value, symbol.size, symbol.type, SymbolIndex::SOURCE_SYMTAB);
+        }
+        index->finalize();
+        return index;
+    }
+}
+
+std::shared_ptr<const SymbolIndex> SandHook::LoadMiniDebugInfo(const std::string &key, std::span<const uint8_t> compressed) {
+    static std::mutex lock;
+    static std::unordered_map<std::string, std::shared_ptr<const SymbolIndex>> cache;
+
+    std::lock_guard guard(lock);
+
+    if (auto i = cache.find(key); i != cache.end()) {
+        LOGD("using cached MiniDebugInfo for {}", key);
+        return i->second;
+    }
+
+    auto index = Decode(compressed);
+    LOGD("decoded {} symbols from MiniDebugInfo for {}", index ? index->size() : 0, key);
+    cache.emplace(key, index);
+    return index;
+}
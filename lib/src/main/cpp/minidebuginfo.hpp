@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include "symbol_index.hpp"
+
+namespace SandHook {
+    /**
+     * Decodes the .symtab of an xz-compressed MiniDebugInfo (.gnu_debugdata) section into a symbol index.
+     * The section is decompressed as a stream and parsed without ever holding the whole decompressed ELF.
+     * This takes two passes, one for the section headers at its end and one for the symbols.
+     * Only if the .strtab precedes the .symtab is a copy of the .strtab held until the symbols have been read.
+     * Results (including failures) are cached process-wide by key, so other images of the same build reuse them.
+     * @param key Identifies the build the section belongs to, preferably by its GNU build ID.
+     * @param compressed Contents of the .gnu_debugdata section.
+     * @return nullptr if the section could not be decoded.
+     */
+    std::shared_ptr<const SymbolIndex> LoadMiniDebugInfo(const std::string &key, std::span<const uint8_t> compressed);
+}
@@ -1,4 +1,13 @@
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
 #include <cstdint>
+#include <mutex>
+#include <fcntl.h>
+#include <link.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
 #include "proc_maps.hpp"
 #include "logging.hpp"
 
@@ -50,3 +59,223 @@ bool proc_map_parse(std::vector<proc_map_t> &maps) {
     fclose(fp);
     return true;
 }
+
+proc_map_generation_t proc_map_generation() {
+    proc_map_generation_t generation{};
+
+    dl_iterate_phdr([](dl_phdr_info *info, size_t size, void *data) -> int {
+        auto *gen = reinterpret_cast<proc_map_generation_t *>(data);
+
+        // Every entry reports the same global counters, so the first one is enough
+        if (size >= offsetof(dl_phdr_info, dlpi_subs) + sizeof(info->dlpi_subs)) {
+            gen->adds = info->dlpi_adds;
+            gen->subs = info->dlpi_subs;
+            return 1;
+        }
+
+        // Older linkers lack the counters, so fingerprint the loaded modules instead
+        gen->adds += 1;
+        gen->subs = gen->subs * 31 + info->dlpi_addr;
+        return 0;
+    }, &generation);
+
+    return generation;
+}
+
+std::shared_ptr<const std::vector<proc_map_t>> proc_map_snapshot(bool force_refresh, bool *refreshed) {
+    static std::mutex lock;
+    static std::shared_ptr<const std::vector<proc_map_t>> snapshot;
+    static proc_map_generation_t snapshot_generation;
+
+    std::lock_guard guard(lock);
+
+    auto generation = proc_map_generation();
+    if (snapshot && !force_refresh && generation == snapshot_generation) {
+        if (refreshed) *refreshed = false;
+        return snapshot;
+    }
+
+    auto maps = std::make_shared<std::vector<proc_map_t>>();
+    if (!proc_map_parse(*maps)) {
+        snapshot = nullptr;
+        return nullptr;
+    }
+
+    LOGD("parsed new maps snapshot with {} entries", maps->size());
+    snapshot = std::move(maps);
+    snapshot_generation = generation;
+    if (refreshed) *refreshed = true;
+    return snapshot;
+}
+
+/* Mirrors struct procmap_query from <linux/fs.h>, which older NDK headers lack */
+struct procmap_query_args {
+    uint64_t size;
+    uint64_t query_flags;
+    uint64_t query_addr;
+    uint64_t vma_start;
+    uint64_t vma_end;
+    uint64_t vma_flags;
+    uint64_t vma_page_size;
+    uint64_t vma_offset;
+    uint64_t inode;
+    uint32_t dev_major;
+    uint32_t dev_minor;
+    uint32_t vma_name_size;
+    uint32_t build_id_size;
+    uint64_t vma_name_addr;
+    uint64_t build_id_addr;
+};
+
+static constexpr uint64_t PROCMAP_QUERY_VMA_READABLE = 0x01;
+static constexpr uint64_t PROCMAP_QUERY_VMA_WRITABLE = 0x02;
+static constexpr uint64_t PROCMAP_QUERY_VMA_EXECUTABLE = 0x04;
+static constexpr uint64_t PROCMAP_QUERY_VMA_SHARED = 0x08;
+static constexpr uint64_t PROCMAP_QUERY_COVERING_OR_NEXT_VMA = 0x10;
+static constexpr uint64_t PROCMAP_QUERY_FILE_BACKED_VMA = 0x20;
+
+#define PROCMAP_QUERY_IOCTL _IOWR('f', 17, struct procmap_query_args)
+
+enum procmap_query_support : int8_t {
+    PROCMAP_QUERY_SUPPORT_UNKNOWN = 0,
+    PROCMAP_QUERY_SUPPORTED = 1,
+    PROCMAP_QUERY_UNSUPPORTED = -1,
+};
+
+static std::atomic<procmap_query_support> procmap_query_state = PROCMAP_QUERY_SUPPORT_UNKNOWN;
+
+static int proc_map_query_fd() {
+    static std::mutex lock;
+    static int fd = -1;
+    static pid_t fd_pid = 0;
+
+    std::lock_guard guard(lock);
+
+    // The fd keeps referring to the parent's maps after a fork
+    if (pid_t pid = getpid(); fd < 0 || fd_pid != pid) {
+        if (fd >= 0) close(fd);
+        fd = open("/proc/self/maps", O_RDONLY | O_CLOEXEC);
+        fd_pid = pid;
+    }
+
+    return fd;
+}
+
+/**
+ * @return 1 if found, 0 if there is no matching mapping, -1 if this query failed,
+ *         -2 if the kernel does not implement the ioctl.
+ */
+static int proc_map_query_ioctl(const void *address, proc_map_t &map, proc_map_flags_t required_flags, uint8_t query_flags) {
+    int fd = proc_map_query_fd();
+    if (fd < 0) return -1;
+
+    char name[PATH_MAX];
+    procmap_query_args query{
+            .size = sizeof(procmap_query_args),
+            .query_flags = (required_flags & PROC_MAP_READ ? PROCMAP_QUERY_VMA_READABLE : 0u)
+                           | (required_flags & PROC_MAP_WRITE ? PROCMAP_QUERY_VMA_WRITABLE : 0u)
+                           | (required_flags & PROC_MAP_EXEC ? PROCMAP_QUERY_VMA_EXECUTABLE : 0u)
+                           | (required_flags & PROC_MAP_SHARED ? PROCMAP_QUERY_VMA_SHARED : 0u)
+                           | (query_flags & PROC_MAP_QUERY_COVERING_OR_NEXT ? PROCMAP_QUERY_COVERING_OR_NEXT_VMA : 0u)
+                           | (query_flags & PROC_MAP_QUERY_FILE_BACKED ? PROCMAP_QUERY_FILE_BACKED_VMA : 0u),
+            .query_addr = reinterpret_cast<uintptr_t>(address),
+            .vma_start = 0,
+            .vma_end = 0,
+            .vma_flags = 0,
+            .vma_page_size = 0,
+            .vma_offset = 0,
+            .inode = 0,
+            .dev_major = 0,
+            .dev_minor = 0,
+            .vma_name_size = sizeof(name),
+            .build_id_size = 0,
+            .vma_name_addr = reinterpret_cast<uintptr_t>(name),
+            .build_id_addr = 0,
+    };
+
+    if (ioctl(fd, PROCMAP_QUERY_IOCTL, &query) != 0) {
+        switch (errno) {
+            case ENOENT:
+                return 0;
+            // Unknown ioctl, or a query layout this kernel doesn't understand
+            case ENOTTY:
+            case EINVAL:
+                return -2;
+            default:
+                return -1;
+        }
+    }
+
+    map.address_start = reinterpret_cast<void *>(query.vma_start);
+    map.address_end = reinterpret_cast<void *>(query.vma_end);
+    map.flags = (query.vma_flags & PROCMAP_QUERY_VMA_READABLE ? PROC_MAP_READ : 0)
+                | (query.vma_flags & PROCMAP_QUERY_VMA_WRITABLE ? PROC_MAP_WRITE : 0)
+                | (query.vma_flags & PROCMAP_QUERY_VMA_EXECUTABLE ? PROC_MAP_EXEC : 0)
+                | (query.vma_flags & PROCMAP_QUERY_VMA_SHARED ? PROC_MAP_SHARED : PROC_MAP_PRIVATE);
+    map.offset = query.vma_offset;
+    map.dev_major = query.dev_major;
+    map.dev_minor = query.dev_minor;
+    map.inode = query.inode;
+    // vma_name_size includes the null terminator, and is 0 for anonymous mappings
+    map.file_name.assign(name, query.vma_name_size ? query.vma_name_size - 1 : 0);
+    return 1;
+}
+
+bool proc_map_query_text(const void *address, proc_map_t &map, proc_map_flags_t required_flags, uint8_t query_flags) {
+    std::vector<proc_map_t> maps;
+    if (!proc_map_parse(maps)) return false;
+
+    required_flags &= PROC_MAP_READ | PROC_MAP_WRITE | PROC_MAP_EXEC | PROC_MAP_SHARED;
+
+    for (auto &entry: maps) {
+        if (entry.address_end <= address)
+            continue;
+
+        bool matches = (entry.flags & required_flags) == required_flags
+                       && (!(query_flags & PROC_MAP_QUERY_FILE_BACKED) || entry.inode != 0);
+        bool covering = entry.address_start <= address;
+
+        if (matches && (covering || (query_flags & PROC_MAP_QUERY_COVERING_OR_NEXT))) {
+            map = std::move(entry);
+            return true;
+        }
+        if (!(query_flags & PROC_MAP_QUERY_COVERING_OR_NEXT))
+            return false;
+    }
+    return false;
+}
+
+bool proc_map_query(const void *address, proc_map_t &map, proc_map_flags_t required_flags, uint8_t query_flags) {
+    if (procmap_query_state.load(std::memory_order_relaxed) != PROCMAP_QUERY_UNSUPPORTED) {
+        int res = proc_map_query_ioctl(address, map, required_flags, query_flags);
+        if (res >= 0) {
+            procmap_query_state.store(PROCMAP_QUERY_SUPPORTED, std::memory_order_relaxed);
+            return res == 1;
+        }
+
+        if (res == -2) {
+            LOGD("PROCMAP_QUERY unsupported ({}), falling back to parsing maps", errno);
+            procmap_query_state.store(PROCMAP_QUERY_UNSUPPORTED, std::memory_order_relaxed);
+        } else {
+            // Possibly transient (e.g. out of fds), so only this query falls back
+            LOGD("PROCMAP_QUERY failed ({}), parsing maps instead", errno);
+        }
+    }
+
+    return proc_map_query_text(address, map, required_flags, query_flags);
+}
+
+bool proc_map_query_supported() {
+    if (auto state = procmap_query_state.load(std::memory_order_relaxed); state != PROCMAP_QUERY_SUPPORT_UNKNOWN)
+        return state == PROCMAP_QUERY_SUPPORTED;
+
+    // Nothing is mapped at null, so this only succeeds or fails with ENOENT when the ioctl exists
+    proc_map_t map;
+    int res = proc_map_query_ioctl(nullptr, map, 0, 0);
+    if (res >= 0) {
+        procmap_query_state.store(PROCMAP_QUERY_SUPPORTED, std::memory_order_relaxed);
+    } else if (res == -2) {
+        procmap_query_state.store(PROCMAP_QUERY_UNSUPPORTED, std::memory_order_relaxed);
+    }
+    return res >= 0;
+}
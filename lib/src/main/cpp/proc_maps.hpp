@@ -2,7 +2,9 @@
 #define PROC_MAP_UTIL_HPP
 
 #include <cstdlib>
+#include <memory>
 #include <optional>
+#include <string>
 #include <vector>
 
 typedef uint8_t proc_map_flags_t;
@@ -15,6 +17,13 @@ enum proc_map_flags : uint8_t {
     PROC_MAP_PRIVATE = 1 << 4,
 };
 
+enum proc_map_query_flags : uint8_t {
+    /* Return the next matching mapping above the address when the covering one is missing or doesn't match */
+    PROC_MAP_QUERY_COVERING_OR_NEXT = 1 << 0,
+    /* Only match mappings that are backed by a file */
+    PROC_MAP_QUERY_FILE_BACKED = 1 << 1,
+};
+
 struct proc_map_t {
     void *address_start;
     void *address_end;
@@ -28,4 +37,46 @@ struct proc_map_t {
 
 bool proc_map_parse(std::vector<proc_map_t> &maps);
 
+struct proc_map_generation_t {
+    unsigned long long adds;
+    unsigned long long subs;
+
+    bool operator==(const proc_map_generation_t &) const = default;
+};
+
+/**
+ * Gets the dynamic linker's counts of loaded and unloaded modules, which change whenever a module is (un)loaded.
+ * This is much cheaper than parsing /proc/self/maps.
+ */
+proc_map_generation_t proc_map_generation();
+
+/**
+ * Gets a process-wide snapshot of /proc/self/maps that is shared between callers.
+ * It is only reparsed once the dynamic linker reports that modules have been loaded or unloaded since it was taken,
+ * so mappings made without the dynamic linker may be missing from it until a refresh is forced.
+ * @param force_refresh Reparse /proc/self/maps even if no module changes were detected.
+ * @param refreshed Set to whether the returned snapshot was just parsed.
+ * @return nullptr if /proc/self/maps could not be parsed.
+ */
+std::shared_ptr<const std::vector<proc_map_t>> proc_map_snapshot(bool force_refresh = false, bool *refreshed = nullptr);
+
+/**
+ * Finds the mapping covering an address without parsing all of /proc/self/maps when possible.
+ * This uses the PROCMAP_QUERY ioctl (Linux 6.11+) and falls back to parsing /proc/self/maps on older kernels.
+ * @param required_flags Permissions the mapping must have, out of PROC_MAP_READ, PROC_MAP_WRITE, PROC_MAP_EXEC and PROC_MAP_SHARED.
+ * @param query_flags Combination of proc_map_query_flags.
+ * @return false if no matching mapping was found.
+ */
+bool proc_map_query(const void *address, proc_map_t &map, proc_map_flags_t required_flags = 0, uint8_t query_flags = 0);
+
+/**
+ * Same as proc_map_query(), but always parses /proc/self/maps.
+ */
+bool proc_map_query_text(const void *address, proc_map_t &map, proc_map_flags_t required_flags = 0, uint8_t query_flags = 0);
+
+/**
+ * Whether proc_map_query() can use the PROCMAP_QUERY ioctl instead of the text parser.
+ */
+bool proc_map_query_supported();
+
 #endif //PROC_MAP_UTIL_HPP
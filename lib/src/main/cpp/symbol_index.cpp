@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <cstring>
+#include "symbol_index.hpp"
+
+using namespace SandHook;
+
+static_assert(sizeof(SymbolIndex::Entry) == sizeof(ElfW(Addr)) + 16, "Entry must not contain implicit padding");
+
+namespace {
+    constexpr uint32_t SERIALIZED_MAGIC = 0x49534853; // "SHSI"
+    constexpr uint16_t SERIALIZED_VERSION = 2;
+
+    struct SerializedHeader {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t entry_size;
+        int64_t bias;
+        uint32_t entry_count;
+        uint32_t arena_size;
+        uint64_t file_size;
+        uint64_t inode;
+        int64_t mtime;
+        uint64_t file_offset;
+        uint32_t build_id_size;
+        uint32_t reserved;
+    };
+}
+
+void SymbolIndex::add(std::string_view name, ElfW(Addr) value, uint32_t size, uint8_t type, Source source) {
+    if (name.empty()) return;
+
+    pending_.emplace_back(name, Entry{
+            .value = value,
+            .name_offset = 0,
+            .name_length = static_cast<uint32_t>(name.size()),
+            .size = size,
+            .type = type,
+            .source = source,
+            .reserved = 0,
+    });
+}
+
+void SymbolIndex::finalize() {
+    if (pending_.empty()) return;
+
+    // Merge the already finalized entries back in so that finalize() can be called more than once
+    std::vector<std::string> existing;
+    existing.reserve(entries_.size());
+    for (const auto &entry: entries_) {
+        pending_.emplace_back(existing.emplace_back(nameOf(entry)), entry);
+    }
+
+    std::ranges::sort(pending_, [](const auto &a, const auto &b) {
+        if (auto cmp = a.first.compare(b.first); cmp != 0) return cmp < 0;
+        return a.second.source < b.second.source;
+    });
+
+    std::string arena;
+    std::vector<Entry> entries;
+    entries.reserve(pending_.size());
+
+    std::string_view last_name;
+    uint32_t last_offset = 0;
+    for (auto &[name, entry]: pending_) {
+        // Names are sorted, so duplicates are always adjacent
+        if (entries.empty() || name != last_name) {
+            last_offset = static_cast<uint32_t>(arena.size());
+            last_name = name;
+            arena.append(name);
+        }
+        entry.name_offset = last_offset;
+        entries.emplace_back(entry);
+    }
+
+    pending_.clear();
+    pending_.shrink_to_fit();
+    arena.shrink_to_fit();
+    entries_ = std::move(entries);
+    arena_ = std::move(arena);
+}
+
+std::vector<SymbolIndex::Entry>::const_iterator SymbolIndex::lowerBound(std::string_view name) const {
+    return std::lower_bound(entries_.begin(), entries_.end(), name, [this](const Entry &entry, std::string_view value) {
+        return nameOf(entry) < value;
+    });
+}
+
+ElfW(Addr) SymbolIndex::lookup(std::string_view name) const {
+    for (auto i = lowerBound(name); i != entries_.end() && nameOf(*i) == name; ++i) {
+        if (i->value) return i->value;
+    }
+    return 0;
+}
+
+std::vector<ElfW(Addr)> SymbolIndex::rangeLookup(std::string_view name, uint8_t sources) const {
+    std::vector<ElfW(Addr)> res;
+    for (auto i = lowerBound(name); i != entries_.end() && nameOf(*i) == name; ++i) {
+        if (i->source & sources) res.emplace_back(i->value);
+    }
+    return res;
+}
+
+ElfW(Addr) SymbolIndex::prefixLookupFirst(std::string_view prefix, uint8_t sources) const {
+    for (auto i = lowerBound(prefix); i != entries_.end() && nameOf(*i).starts_with(prefix); ++i) {
+        if (i->source & sources) return i->value;
+    }
+    return 0;
+}
+
+std::vector<uint8_t> SymbolIndex::serialize() const {
+    SerializedHeader header{
+            .magic = SERIALIZED_MAGIC,
+            .version = SERIALIZED_VERSION,
+            .entry_size = sizeof(Entry),
+            .bias = bias_,
+            .entry_count = static_cast<uint32_t>(entries_.size()),
+            .arena_size = static_cast<uint32_t>(arena_.size()),
+            .file_size = identity_.file_size,
+            .inode = identity_.inode,
+            .mtime = identity_.mtime,
+            .file_offset = identity_.file_offset,
+            .build_id_size = static_cast<uint32_t>(identity_.build_id.size()),
+            .reserved = 0,
+    };
+
+    auto entries_size = entries_.size() * sizeof(Entry);
+    std::vector<uint8_t> out(sizeof(header) + identity_.build_id.size() + entries_size + arena_.size());
+    auto *pos = out.data();
+    memcpy(pos, &header, sizeof(header));
+    memcpy(pos += sizeof(header), identity_.build_id.data(), identity_.build_id.size());
+    memcpy(pos += identity_.build_id.size(), entries_.data(), entries_size);
+    memcpy(pos += entries_size, arena_.data(), arena_.size());
+    return out;
+}
+
+std::optional<SymbolIndex> SymbolIndex::deserialize(std::span<const uint8_t> data) {
+    SerializedHeader header;
+    if (data.size() < sizeof(header)) return std::nullopt;
+    memcpy(&header, data.data(), sizeof(header));
+
+    // The entry size doubles as an ABI check since it depends on sizeof(ElfW(Addr))
+    if (header.magic != SERIALIZED_MAGIC || header.version != SERIALIZED_VERSION || header.entry_size != sizeof(Entry))
+        return std::nullopt;
+
+    // Computed in 64 bits since the counts come from storage and would overflow size_t on 32-bit ABIs
+    auto entries_size = static_cast<uint64_t>(header.entry_count) * sizeof(Entry);
+    if (data.size() != uint64_t{sizeof(header)} + header.build_id_size + entries_size + header.arena_size)
+        return std::nullopt;
+
+    SymbolIndex index;
+    index.bias_ = static_cast<off_t>(header.bias);
+
+    auto *pos = data.data() + sizeof(header);
+    index.identity_ = {
+            .build_id = std::string(reinterpret_cast<const char *>(pos), header.build_id_size),
+            .file_size = header.file_size,
+            .inode = header.inode,
+            .mtime = header.mtime,
+            .file_offset = header.file_offset,
+    };
+
+    index.entries_.resize(header.entry_count);
+    memcpy(index.entries_.data(), pos += header.build_id_size, entries_size);
+    index.arena_.assign(reinterpret_cast<const char *>(pos += entries_size), header.arena_size);
+
+    for (const auto &entry: index.entries_) {
+        if (entry.name_offset > index.arena_.size() || entry.name_length > index.arena_.size() - entry.name_offset)
+            return std::nullopt;
+    }
+
+    return index;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/types.h>
+#include <link.h>
+
+namespace SandHook {
+    /**
+     * Compact, self-contained index of the symbols of an ELF image.
+     * Names are deduplicated into a single owned arena and entries are kept sorted by name,
+     * so that lookups no longer depend on the ELF file staying mapped.
+     */
+    class SymbolIndex {
+    public:
+        enum Source : uint8_t {
+            SOURCE_DYNSYM = 1 << 0,
+            SOURCE_SYMTAB = 1 << 1,
+        };
+
+        // Laid out without implicit padding so that serialize() output is deterministic
+        struct Entry {
+            ElfW(Addr) value;
+            uint32_t name_offset;
+            uint32_t name_length;
+            uint32_t size;
+            uint8_t type;
+            uint8_t source;
+            uint16_t reserved;
+        };
+
+        /**
+         * Identifies the build of the ELF file an index was created from.
+         */
+        struct Identity {
+            /* Hex GNU build ID, if present the file fields below are left as 0 */
+            std::string build_id;
+            uint64_t file_size = 0;
+            uint64_t inode = 0;
+            int64_t mtime = 0;
+            uint64_t file_offset = 0;
+
+            bool operator==(const Identity &) const = default;
+        };
+
+        /**
+         * Queues a symbol to be indexed. The name must stay valid until finalize() is called.
+         */
+        void add(std::string_view name, ElfW(Addr) value, uint32_t size, uint8_t type, Source source);
+
+        /**
+         * Sorts the queued symbols and copies their names into the arena, merging duplicate names.
+         */
+        void finalize();
+
+        /**
+         * Gets the value of the first symbol with this name, preferring dynsym over symtab entries.
+         * @return 0 if not found.
+         */
+        ElfW(Addr) lookup(std::string_view name) const;
+
+        /**
+         * Gets the values of all symbols with this name that came from one of the specified sources.
+         */
+        std::vector<ElfW(Addr)> rangeLookup(std::string_view name, uint8_t sources) const;
+
+        /**
+         * Gets the value of the lexicographically first symbol starting with this prefix from one of the specified sources.
+         * @return 0 if not found.
+         */
+        ElfW(Addr) prefixLookupFirst(std::string_view prefix, uint8_t sources) const;
+
+        /**
+         * Serializes this index into a buffer that can be reloaded with deserialize() by the same ABI.
+         * The identity is included so that a reloaded index can be checked against the module it is used for.
+         */
+        std::vector<uint8_t> serialize() const;
+
+        static std::optional<SymbolIndex> deserialize(std::span<const uint8_t> data);
+
+        off_t bias() const {
+            return bias_;
+        }
+
+        void setBias(off_t bias) {
+            bias_ = bias;
+        }
+
+        const Identity &identity() const {
+            return identity_;
+        }
+
+        void setIdentity(Identity identity) {
+            identity_ = std::move(identity);
+        }
+
+        size_t size() const {
+            return entries_.size();
+        }
+
+        bool empty() const {
+            return entries_.empty();
+        }
+
+    private:
+        std::string_view nameOf(const Entry &entry) const {
+            return {arena_.data() + entry.name_offset, entry.name_length};
+        }
+
+        std::vector<Entry>::const_iterator lowerBound(std::string_view name) const;
+
+        off_t bias_ = 0;
+        Identity identity_;
+        std::vector<Entry> entries_;
+        std::string arena_;
+        std::vector<std::pair<std::string_view, Entry>> pending_;
+    };
+}
@@ -0,0 +1,60 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include "../hermes_profiler.hpp"
+
+/*
+ * Resolves the sampling profiler from the stand-in libhermes.so this is linked against,
+ * and checks that calls reach it and that its exceptions are turned into failures.
+ */
+
+extern "C" void hermes_standin_set_profiler_compiled(bool compiled);
+extern "C" bool hermes_standin_profiler_enabled();
+extern "C" double hermes_standin_profiler_hz();
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+int main() {
+    SandHook::ElfImg hermes("libhermes.so");
+    CHECK(hermes.isValid());
+
+    hermes_profiler_resolve(hermes);
+    CHECK(hermes_profiler_supported());
+
+    CHECK(hermes_profiler_enable(250));
+    CHECK(hermes_standin_profiler_enabled());
+    CHECK(hermes_standin_profiler_hz() == 250);
+    CHECK(hermes_profiler_disable());
+    CHECK(!hermes_standin_profiler_enabled());
+
+    std::string error;
+    std::string trace = "/tmp/hermes_profiler_test." + std::to_string(getpid()) + ".json";
+    CHECK(hermes_profiler_dump(trace, error) == 1);
+    CHECK(access(trace.c_str(), F_OK) == 0);
+    unlink(trace.c_str());
+
+    // Hermes throws std::system_error when the trace file can't be opened
+    CHECK(hermes_profiler_dump("/nonexistent/trace.json", error) == -1);
+    CHECK(error.find("/nonexistent/trace.json") != std::string::npos);
+
+    // Builds without profiler support throw from every entry point
+    hermes_standin_set_profiler_compiled(false);
+    CHECK(!hermes_profiler_enable(100));
+    CHECK(!hermes_profiler_disable());
+    CHECK(hermes_profiler_dump(trace, error) == -1);
+
+    if (failures) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("all checks passed\n");
+    return EXIT_SUCCESS;
+}
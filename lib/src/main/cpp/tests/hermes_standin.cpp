@@ -0,0 +1,73 @@
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+/*
+ * Stand-in for libhermes.so that exports the HermesRuntime symbols LibUnbound resolves,
+ * throwing the same kinds of exceptions as Hermes does on failure.
+ */
+
+static bool profilerCompiled = true;
+static bool profilerEnabled = false;
+static double profilerHz = 0;
+
+extern "C" void hermes_standin_set_profiler_compiled(bool compiled) {
+    profilerCompiled = compiled;
+}
+
+extern "C" bool hermes_standin_profiler_enabled() {
+    return profilerEnabled;
+}
+
+extern "C" double hermes_standin_profiler_hz() {
+    return profilerHz;
+}
+
+static void checkProfilerCompiled() {
+    if (!profilerCompiled)
+        throw std::logic_error("Hermes was not compiled with SamplingProfilerSupport");
+}
+
+namespace facebook::hermes {
+    class HermesRuntime {
+    public:
+        static uint32_t getBytecodeVersion();
+
+        static void enableSamplingProfiler(double meanHzFreq);
+
+        static void disableSamplingProfiler();
+    };
+
+    uint32_t HermesRuntime::getBytecodeVersion() {
+        return 96;
+    }
+
+    void HermesRuntime::enableSamplingProfiler(double meanHzFreq) {
+        checkProfilerCompiled();
+        profilerEnabled = true;
+        profilerHz = meanHzFreq;
+    }
+
+    void HermesRuntime::disableSamplingProfiler() {
+        checkProfilerCompiled();
+        profilerEnabled = false;
+    }
+}
+
+// Named after Android's libc++ std::string, which host standard libraries mangle differently
+void dumpSampledTraceToFile(const std::string &fileName) __asm__(
+        "_ZN8facebook6hermes13HermesRuntime22dumpSampledTraceToFileERKNSt6__ndk112basic_stringIcNS2_11char_traitsIcEENS2_9allocatorIcEEEE");
+
+void dumpSampledTraceToFile(const std::string &fileName) {
+    checkProfilerCompiled();
+
+    FILE *fp = fopen(fileName.c_str(), "w");
+    if (!fp)
+        throw std::system_error(errno, std::generic_category(), "Failed to open file " + fileName);
+
+    fputs("[]", fp);
+    fclose(fp);
+}
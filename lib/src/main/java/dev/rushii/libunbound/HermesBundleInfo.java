@@ -0,0 +1,89 @@
+package dev.rushii.libunbound;
+
+/**
+ * Summary of a Hermes bytecode (HBC) bundle, obtained from its file header without loading the bundle.
+ *
+ * @see LibUnbound#inspectHermesBundle(String)
+ */
+@SuppressWarnings("unused")
+public final class HermesBundleInfo {
+	/**
+	 * HBC version the bundle was compiled for.
+	 */
+	public final int version;
+	/**
+	 * Length of the bundle in bytes according to its header.
+	 */
+	public final long fileLength;
+	/**
+	 * Length of the bundle in bytes on disk.
+	 */
+	public final long actualLength;
+	public final int functionCount;
+	public final int stringCount;
+	public final int identifierCount;
+	/**
+	 * Size in bytes of the string table's storage.
+	 */
+	public final int stringStorageSize;
+	public final int bigIntCount;
+	/**
+	 * Size in bytes of the BigInt table's storage.
+	 */
+	public final int bigIntStorageSize;
+	public final int regExpCount;
+	public final int cjsModuleCount;
+	/**
+	 * Whether the bundle is shorter than its header claims, such as from an interrupted download.
+	 */
+	public final boolean truncated;
+	/**
+	 * Whether the header layout of this HBC version is known and all sections fit within the bundle.
+	 * If the layout is unknown, only {@link #version}, the lengths and {@link #functionCount} are populated.
+	 */
+	public final boolean layoutValid;
+	/**
+	 * Whether {@link #version} matches the HBC version supported by the loaded Hermes runtime.
+	 */
+	public final boolean matchesRuntimeVersion;
+
+	// Constructed from native code
+	private HermesBundleInfo(
+		int version,
+		long fileLength,
+		long actualLength,
+		int functionCount,
+		int stringCount,
+		int identifierCount,
+		int stringStorageSize,
+		int bigIntCount,
+		int bigIntStorageSize,
+		int regExpCount,
+		int cjsModuleCount,
+		boolean truncated,
+		boolean layoutValid,
+		boolean matchesRuntimeVersion
+	) {
+		this.version = version;
+		this.fileLength = fileLength;
+		this.actualLength = actualLength;
+		this.functionCount = functionCount;
+		this.stringCount = stringCount;
+		this.identifierCount = identifierCount;
+		this.stringStorageSize = stringStorageSize;
+		this.bigIntCount = bigIntCount;
+		this.bigIntStorageSize = bigIntStorageSize;
+		this.regExpCount = regExpCount;
+		this.cjsModuleCount = cjsModuleCount;
+		this.truncated = truncated;
+		this.layoutValid = layoutValid;
+		this.matchesRuntimeVersion = matchesRuntimeVersion;
+	}
+
+	/**
+	 * Whether this bundle is complete, well-formed and compiled for the loaded Hermes runtime.
+	 */
+	public boolean isLoadable() {
+		return !truncated && layoutValid && matchesRuntimeVersion;
+	}
+}
@@ -1,5 +1,9 @@
 package dev.rushii.libunbound;
 
+import java.io.IOException;
+import java.nio.ByteOrder;
+import java.nio.LongBuffer;
+import java.util.Map;
 import java.util.Objects;
 
 /**
@@ -36,7 +40,194 @@ public class LibUnbound {
 		return isHermesBytecode0(Objects.requireNonNull(bytes));
 	}
 
+	/**
+	 * Whether the loaded Hermes runtime exports the sampling profiler controls.
+	 * If not, the sampling profiler methods do nothing and return false.
+	 */
+	public static boolean isSamplingProfilerSupported() {
+		return isSamplingProfilerSupported0();
+	}
+
+	/**
+	 * Starts the Hermes sampling profiler at the default frequency of 100Hz.
+	 *
+	 * @return False if the sampling profiler is not available in this Hermes build.
+	 */
+	public static boolean enableSamplingProfiler() {
+		return enableSamplingProfiler0(100);
+	}
+
+	/**
+	 * Starts the Hermes sampling profiler for all runtimes that registered for profiling.
+	 *
+	 * @param meanHzFreq Mean sampling frequency in Hz. This is ignored by older Hermes versions.
+	 * @return False if the sampling profiler is not available in this Hermes build.
+	 */
+	public static boolean enableSamplingProfiler(double meanHzFreq) {
+		return enableSamplingProfiler0(meanHzFreq);
+	}
+
+	/**
+	 * Stops the Hermes sampling profiler.
+	 *
+	 * @return False if the sampling profiler is not available in this Hermes build.
+	 */
+	public static boolean disableSamplingProfiler() {
+		return disableSamplingProfiler0();
+	}
+
+	/**
+	 * Writes the samples collected by the Hermes sampling profiler to a file in the Chrome trace format.
+	 *
+	 * @param path Nonnull path of the file to write to.
+	 * @return False if the sampling profiler is not available in this Hermes build.
+	 * @throws IOException If Hermes failed to write the trace, such as when the file could not be opened.
+	 */
+	public static boolean dumpSampledTraceToFile(String path) throws IOException {
+		return dumpSampledTraceToFile0(Objects.requireNonNull(path));
+	}
+
+	/**
+	 * Obtains heap statistics of a JS runtime through its JSI instrumentation, such as {@code hermes_heapSize}.
+	 * This must be called on the runtime's JS thread.
+	 *
+	 * @param runtimePtr       Pointer to a live {@code jsi::Runtime}, such as from {@code JavaScriptContextHolder#get()}.
+	 * @param includeExpensive Whether to include statistics that are expensive to compute.
+	 * @return Statistic names mapped to their values. Empty if the runtime does not implement instrumentation.
+	 * @throws RuntimeException If the runtime failed to collect the statistics.
+	 */
+	public static Map<String, Long> getHeapInfo(long runtimePtr, boolean includeExpensive) {
+		return getHeapInfo0(checkRuntimePtr(runtimePtr), includeExpensive);
+	}
+
+	/**
+	 * Obtains the GC statistics recorded by a JS runtime through its JSI instrumentation, as JSON.
+	 * This must be called on the runtime's JS thread.
+	 *
+	 * @param runtimePtr Pointer to a live {@code jsi::Runtime}, such as from {@code JavaScriptContextHolder#get()}.
+	 * @return Empty if the runtime does not record GC statistics.
+	 * @throws RuntimeException If the runtime failed to collect the statistics.
+	 */
+	public static String getRecordedGCStats(long runtimePtr) {
+		return getRecordedGCStats0(checkRuntimePtr(runtimePtr));
+	}
+
+	private static long checkRuntimePtr(long runtimePtr) {
+		if (runtimePtr == 0)
+			throw new IllegalArgumentException("runtimePtr must not be null");
+		return runtimePtr;
+	}
+
+	/**
+	 * Resolves the addresses of many symbols in arbitrary loaded libraries within a single native call.
+	 * Each library is parsed once and then kept cached, until it is found to have been unloaded or replaced.
+	 * Libraries that are not loaded are only looked up again once another library has been loaded.
+	 *
+	 * @param libraries Nonnull library name for each symbol, such as {@code libhermes.so}.
+	 *                  Reusing the same String instance for consecutive symbols in one library is fastest.
+	 * @param symbols   Nonnull (mangled) symbol names, parallel to {@code libraries}.
+	 * @param out       Receives the address of each symbol, or 0 if it could not be resolved.
+	 * @return The amount of symbols that were resolved.
+	 */
+	public static int resolveSymbols(String[] libraries, String[] symbols, long[] out) {
+		checkResolveSymbolsArgs(libraries, symbols, Objects.requireNonNull(out).length);
+		return resolveSymbols0(libraries, symbols, out);
+	}
+
+	/**
+	 * Same as {@link #resolveSymbols(String[], String[], long[])}, but writes into a direct buffer starting
+	 * at index 0, regardless of the buffer's position.
+	 *
+	 * @param out Direct buffer in the native byte order.
+	 */
+	public static int resolveSymbols(String[] libraries, String[] symbols, LongBuffer out) {
+		checkResolveSymbolsArgs(libraries, symbols, Objects.requireNonNull(out).capacity());
+		if (!out.isDirect() || out.order() != ByteOrder.nativeOrder())
+			throw new IllegalArgumentException("LongBuffer must be direct and in the native byte order");
+		if (out.isReadOnly())
+			throw new IllegalArgumentException("LongBuffer must not be read-only");
+
+		return resolveSymbolsDirect0(libraries, symbols, out);
+	}
+
+	/**
+	 * Serializes the parsed symbols of a loaded library, so that a later process can restore them with
+	 * {@link #importSymbolIndex(String, byte[])} instead of parsing the library again.
+	 * The result is only usable by the same ABI and the same build of the library.
+	 *
+	 * @param library Nonnull library name, such as {@code libhermes.so}.
+	 * @return Null if the library is not loaded.
+	 */
+	public static byte[] exportSymbolIndex(String library) {
+		return exportSymbolIndex0(Objects.requireNonNull(library));
+	}
+
+	/**
+	 * Restores symbols previously exported with {@link #exportSymbolIndex(String)}, which are then used by
+	 * {@link #resolveSymbols(String[], String[], long[])} for that library.
+	 *
+	 * @param library Nonnull library name, such as {@code libhermes.so}.
+	 * @param index   Nonnull serialized symbol index.
+	 * @return False if the index is malformed, was exported from a different build of the library, or the library is not loaded.
+	 */
+	public static boolean importSymbolIndex(String library, byte[] index) {
+		return importSymbolIndex0(Objects.requireNonNull(library), Objects.requireNonNull(index));
+	}
+
+	private static void checkResolveSymbolsArgs(String[] libraries, String[] symbols, int outLength) {
+		if (Objects.requireNonNull(libraries).length != Objects.requireNonNull(symbols).length)
+			throw new IllegalArgumentException("libraries and symbols must be the same length");
+		if (outLength < symbols.length)
+			throw new IllegalArgumentException("out is too small to fit all symbols");
+	}
+
+	/**
+	 * Reads the file header of a Hermes bytecode bundle without loading the bundle into memory.
+	 *
+	 * @param path Nonnull path to the bundle.
+	 * @return Null if the file is not a Hermes bytecode bundle.
+	 * @throws IOException If the file could not be opened or mapped, such as when it is empty.
+	 */
+	public static HermesBundleInfo inspectHermesBundle(String path) throws IOException {
+		return inspectHermesBundle0(Objects.requireNonNull(path));
+	}
+
+	/**
+	 * Reads the file header of a Hermes bytecode bundle without loading the bundle into memory.
+	 *
+	 * @param fd Open file descriptor of the bundle, such as from {@code ParcelFileDescriptor#getFd()}. This is not closed.
+	 * @return Null if the file is not a Hermes bytecode bundle.
+	 * @throws IOException If the file could not be mapped, such as when it is empty or a pipe.
+	 */
+	public static HermesBundleInfo inspectHermesBundle(int fd) throws IOException {
+		return inspectHermesBundleFd0(fd);
+	}
+
 	private static native long getHermesRuntimeBytecodeVersion0();
 
 	private static native boolean isHermesBytecode0(byte[] bytes);
+
+	private static native boolean isSamplingProfilerSupported0();
+
+	private static native boolean enableSamplingProfiler0(double meanHzFreq);
+
+	private static native boolean disableSamplingProfiler0();
+
+	private static native boolean dumpSampledTraceToFile0(String path) throws IOException;
+
+	private static native Map<String, Long> getHeapInfo0(long runtimePtr, boolean includeExpensive);
+
+	private static native String getRecordedGCStats0(long runtimePtr);
+
+	private static native int resolveSymbols0(String[] libraries, String[] symbols, long[] out);
+
+	private static native int resolveSymbolsDirect0(String[] libraries, String[] symbols, LongBuffer out);
+
+	private static native byte[] exportSymbolIndex0(String library);
+
+	private static native boolean importSymbolIndex0(String library, byte[] index);
+
+	private static native HermesBundleInfo inspectHermesBundle0(String path) throws IOException;
+
+	private static native HermesBundleInfo inspectHermesBundleFd0(int fd) throws IOException;
 }